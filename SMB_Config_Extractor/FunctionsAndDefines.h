@@ -6,56 +6,168 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+
+#include "stageFile.h"
 
 #define FUNCTIONS_AND_DEFINES
 #define SMB1 0
 #define SMB2 1
 #define SMBX 2
 
-static inline uint32_t readBigInt(FILE *file) {
-	uint32_t c1 = getc(file) << 24;
-	uint32_t c2 = getc(file) << 16;
-	uint32_t c3 = getc(file) << 8;
-	uint32_t c4 = getc(file);
+// Outputs are named after their input with suffixes added, names of this size fit any of them
+#define OUTPUT_NAME_SIZE 512
+// Longest input name, leaves room for the .raw of decompressed files plus the longest suffix after that (.stats.json)
+#define MAX_INPUT_NAME_LENGTH (OUTPUT_NAME_SIZE - sizeof ".raw" - sizeof ".stats.json" + 1)
+
+// Writes filename with suffix added into name
+// Returns -1 if it doesn't fit, a cut off name could be the input itself
+static inline int makeOutputName(char *name, size_t size, const char *filename, const char *suffix) {
+	int length = snprintf(name, size, "%s%s", filename, suffix);
+	if (length < 0 || (size_t)length >= size) {
+		name[0] = '\0';
+		return -1;
+	}
+	return 0;
+}
+
+// Pastes the byte order onto a name, for code that is compiled once per byte order
+// The includer defines ENDIAN_SUFFIX as Big or Little
+#define ENDIAN_CONCAT2(name, suffix) name##suffix
+#define ENDIAN_CONCAT(name, suffix) ENDIAN_CONCAT2(name, suffix)
+#define ENDIAN_NAME(name) ENDIAN_CONCAT(name, ENDIAN_SUFFIX)
+
+// Each reader loads straight from the stage when all of its bytes are there,
+// and only goes byte by byte near the end of the data
+static inline uint32_t readBigInt(StageFile *file) {
+	if (stageHas(file, 4)) {
+		const uint8_t *data = file->data + file->pos;
+		file->pos += 4;
+		return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+	}
+	uint32_t c1 = (uint32_t)stageGetc(file) << 24;
+	uint32_t c2 = (uint32_t)stageGetc(file) << 16;
+	uint32_t c3 = (uint32_t)stageGetc(file) << 8;
+	uint32_t c4 = (uint32_t)stageGetc(file);
+	return (c1 | c2 | c3 | c4);
+}
+
+static inline uint32_t readLittleInt(StageFile *file) {
+	if (stageHas(file, 4)) {
+		const uint8_t *data = file->data + file->pos;
+		file->pos += 4;
+		return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+	}
+	uint32_t c1 = (uint32_t)stageGetc(file);
+	uint32_t c2 = (uint32_t)stageGetc(file) << 8;
+	uint32_t c3 = (uint32_t)stageGetc(file) << 16;
+	uint32_t c4 = (uint32_t)stageGetc(file) << 24;
+	return (c1 | c2 | c3 | c4);
+}
+
+static inline float readBigFloat(StageFile *file) {
+	uint32_t toCast = readBigInt(file);
+	float floatValue;
+	memcpy(&floatValue, &toCast, sizeof(floatValue));
+	return floatValue;
+}
+
+static inline float readLittleFloat(StageFile *file) {
+	uint32_t toCast = readLittleInt(file);
+	float floatValue;
+	memcpy(&floatValue, &toCast, sizeof(floatValue));
+	return floatValue;
+}
+
+static inline uint16_t readBigShort(StageFile *file) {
+	if (stageHas(file, 2)) {
+		const uint8_t *data = file->data + file->pos;
+		file->pos += 2;
+		return (uint16_t)((data[0] << 8) | data[1]);
+	}
+	uint16_t c1 = (uint16_t)stageGetc(file) << 8;
+	uint16_t c2 = (uint16_t)stageGetc(file);
+	return (uint16_t)(c1 | c2);
+}
+
+static inline uint16_t readLittleShort(StageFile *file) {
+	if (stageHas(file, 2)) {
+		const uint8_t *data = file->data + file->pos;
+		file->pos += 2;
+		return (uint16_t)(data[0] | (data[1] << 8));
+	}
+	uint16_t c1 = (uint16_t)stageGetc(file);
+	uint16_t c2 = (uint16_t)stageGetc(file) << 8;
+	return (uint16_t)(c1 | c2);
+}
+
+// Same as above for cursors, past the end of the stage these read zeros
+static inline uint32_t cursorReadBigInt(StageCursor *cursor) {
+	if (cursorHas(cursor, 4)) {
+		const uint8_t *data = cursor->base + cursor->offset;
+		cursor->offset += 4;
+		return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+	}
+	uint32_t c1 = (uint32_t)cursorGetc(cursor) << 24;
+	uint32_t c2 = (uint32_t)cursorGetc(cursor) << 16;
+	uint32_t c3 = (uint32_t)cursorGetc(cursor) << 8;
+	uint32_t c4 = (uint32_t)cursorGetc(cursor);
 	return (c1 | c2 | c3 | c4);
 }
 
-static inline uint32_t readLittleInt(FILE *file) {
-	uint32_t c1 = getc(file);
-	uint32_t c2 = getc(file) << 8;
-	uint32_t c3 = getc(file) << 16;
-	uint32_t c4 = getc(file) << 24;
+static inline uint32_t cursorReadLittleInt(StageCursor *cursor) {
+	if (cursorHas(cursor, 4)) {
+		const uint8_t *data = cursor->base + cursor->offset;
+		cursor->offset += 4;
+		return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+	}
+	uint32_t c1 = (uint32_t)cursorGetc(cursor);
+	uint32_t c2 = (uint32_t)cursorGetc(cursor) << 8;
+	uint32_t c3 = (uint32_t)cursorGetc(cursor) << 16;
+	uint32_t c4 = (uint32_t)cursorGetc(cursor) << 24;
 	return (c1 | c2 | c3 | c4);
 }
 
-static inline float readBigFloat(FILE *file) {
-	uint32_t c1 = getc(file) << 24;
-	uint32_t c2 = getc(file) << 16;
-	uint32_t c3 = getc(file) << 8;
-	uint32_t c4 = getc(file);
-	uint32_t toCast = (c1 | c2 | c3 | c4);
-	float floatValue = *((float *)&toCast);
+static inline float cursorReadBigFloat(StageCursor *cursor) {
+	uint32_t toCast = cursorReadBigInt(cursor);
+	float floatValue;
+	memcpy(&floatValue, &toCast, sizeof(floatValue));
 	return floatValue;
 }
 
-static inline float readLittleFloat(FILE *file) {
+static inline float cursorReadLittleFloat(StageCursor *cursor) {
+	uint32_t toCast = cursorReadLittleInt(cursor);
 	float floatValue;
-	fread(&floatValue, sizeof(float), 1, file);
+	memcpy(&floatValue, &toCast, sizeof(floatValue));
 	return floatValue;
 }
 
-static inline uint16_t readBigShort(FILE *file) {
-	uint16_t c1 = (uint16_t)getc(file) << 8;
-	uint16_t c2 = (uint16_t)getc(file);
+static inline uint16_t cursorReadBigShort(StageCursor *cursor) {
+	if (cursorHas(cursor, 2)) {
+		const uint8_t *data = cursor->base + cursor->offset;
+		cursor->offset += 2;
+		return (uint16_t)((data[0] << 8) | data[1]);
+	}
+	uint16_t c1 = (uint16_t)(cursorGetc(cursor) << 8);
+	uint16_t c2 = (uint16_t)cursorGetc(cursor);
 	return (uint16_t)(c1 | c2);
 }
 
-static inline uint16_t readLittleShort(FILE *file) {
-	uint16_t c1 = (uint16_t)getc(file);
-	uint16_t c2 = (uint16_t)getc(file) << 8;
+static inline uint16_t cursorReadLittleShort(StageCursor *cursor) {
+	if (cursorHas(cursor, 2)) {
+		const uint8_t *data = cursor->base + cursor->offset;
+		cursor->offset += 2;
+		return (uint16_t)(data[0] | (data[1] << 8));
+	}
+	uint16_t c1 = (uint16_t)cursorGetc(cursor);
+	uint16_t c2 = (uint16_t)(cursorGetc(cursor) << 8);
 	return (uint16_t)(c1 | c2);
 }
 
+static inline uint32_t readLittleIntData(const uint8_t* data, int offset) {
+	return (uint32_t)data[offset] | ((uint32_t)data[offset + 1] << 8) | ((uint32_t)data[offset + 2] << 16) | ((uint32_t)data[offset + 3] << 24);
+}
+
 static inline void writeBigInt(FILE *file, uint32_t value) {
 	putc((value >> 24), file);
 	putc((value >> 16), file);
@@ -87,4 +199,14 @@ static inline void writeLittleShort(FILE *file, uint16_t value) {
 	putc((value >> 8), file);
 }
 
+// 64 bit FNV-1a, enough to tell files apart without reading them twice
+static inline uint64_t hashFNV1a(const uint8_t *data, size_t size) {
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= data[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
 #endif // !FUNCTIONS_AND_DEFINES
\ No newline at end of file
@@ -1,12 +1,18 @@
 #include "configExtractor.h"
 
+#include <math.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "FunctionsAndDefines.h"
+#include "itemArray.h"
+#include "offsetMap.h"
+#include "stageModel.h"
 #include "xmlbuddy.h"
 
-#define MAX_NUM_WORMHOLES 256
-
 typedef struct CollisionGroup {
 	int x;
 }CollisionGroup;
@@ -16,763 +22,426 @@ typedef struct {
 	uint32_t offset;
 }ConfigObject;
 
+// Wormhole names are the order their offsets were first seen in
+typedef struct {
+	OffsetKey key;      // The number is always 1 so a wormhole at offset 0 still has a key
+	int name;
+}WormholeSlot;
+
+// Bytes per item for the arrays that are still read field by field
+#define COLLISION_FIELD_SIZE 0x49C
+#define BACKGROUND_MODEL_SIZE 0x38
+#define REFLECTIVE_MODEL_SIZE 0x8
+// Level model Bs step by what the game's own array is read with, not their full size
+#define LEVEL_MODEL_B_STEP 0x4
+#define WORMHOLE_SIZE 0x1C
+
+// A keyframe track that was already decoded, by where it is and how many keyframes were asked for
+typedef struct {
+	OffsetKey key;
+	KeyframeTrack track;
+}TrackSlot;
+
+// Animations of backgrounds, fog and item groups can point at the same tracks, each is only decoded once
+typedef struct {
+	ThreadLock *lock;       // NULL unless collision fields are parsed at the same time
+	OffsetMap slots;
+}TrackCache;
+
+typedef struct {
+	StageCursor stage;
+	StageModel *model;
+	ThreadPool *pool;   // NULL if everything has to be parsed on this thread
+	NameTable *names;   // Shared by every parser of the stage
+	TrackCache *tracks; // Shared by every parser of the stage
+	int collisionMeshes;   // Set if collision triangles are decoded too
+	int error;          // Set if memory ran out, the model is incomplete
+}StageParser;
+
+// One collision triangle as it's stored, the first vertex is at position
+// The other two lie in the triangle's own plane, which is rotated into place by rotation
 typedef struct {
-	uint32_t triangleListOffset;
-	uint32_t gridTriangleListOffet;
-	float gridStartX;
-	float gridStartZ;
-	float gridStepX;
-	float gridStepZ;
-	uint32_t gridStepXCount;
-	uint32_t gridStepZCount;
-}CollisionGroupHeader;
-
-// File Reading Functions (Endianness handling)
-static uint32_t(*readInt)(FILE*);
-static uint32_t(*readIntRev)(FILE*);
-static uint16_t(*readShort)(FILE*);
-static uint16_t(*readShortRev)(FILE*);
-static float(*readFloat)(FILE*);
-static float(*readFloatRev)(FILE*);
+	VectorF32 position;
+	VectorF32 normal;
+	VectorF32 rotation;     // Degrees
+	float vertex2X;
+	float vertex2Y;
+	float vertex3X;
+	float vertex3Y;
+}CollisionTriangle;
+
+// Collision fields are parsed at the same time, each with a parser and model of its own for memory
+typedef struct {
+	uint32_t offset;
+	CollisionField *fields;
+	StageParser *parsers;
+	StageModel *models;
+}CollisionFieldJob;
+
+// Layouts for the item arrays that are decoded a whole array at a time straight into the model
+// SMB2 and SMBX share these, only the byte order differs
+#define VECTOR_F32(offset, type, member) \
+	{ (offset), ITEM_F32, offsetof(type, member.x) }, \
+	{ (offset) + 0x4, ITEM_F32, offsetof(type, member.y) }, \
+	{ (offset) + 0x8, ITEM_F32, offsetof(type, member.z) }
+#define ROTATION(offset, type, member) \
+	{ ITEM_SHORT(offset), ITEM_ROTATION, offsetof(type, member.x) }, \
+	{ ITEM_SHORT((offset) + 0x2), ITEM_ROTATION, offsetof(type, member.y) }, \
+	{ ITEM_SHORT((offset) + 0x4), ITEM_ROTATION, offsetof(type, member.z) }
+
+#define START_POSITION_SIZE 0x14
+static const ItemLayout startPositionLayout = { START_POSITION_SIZE, sizeof(StartPosition), 6, {
+	//                                                                 Offset   Size   Description
+	VECTOR_F32(0x0, StartPosition, position),                       // 0x0      0xC    Position (X, Y, Z)
+	ROTATION(0xC, StartPosition, rotation),                         // 0xC      0x8    Rotation (X, Y, Z, Pad)
+} };
+
+#define GOAL_SIZE 0x14
+static const ItemLayout goalLayout = { GOAL_SIZE, sizeof(Goal), 7, {
+	VECTOR_F32(0x0, Goal, position),                                // 0x0      0xC    Position (X, Y, Z)
+	ROTATION(0xC, Goal, rotation),                                  // 0xC      0x6    Rotation (X, Y, Z)
+	{ ITEM_SHORT(0x12), ITEM_U16, offsetof(Goal, type) },           // 0x12     0x2    Goal Type
+} };
+
+// Bumpers and jamabars share a layout
+#define BUMPER_SIZE 0x20
+static const ItemLayout bumperLayout = { BUMPER_SIZE, sizeof(Bumper), 9, {
+	VECTOR_F32(0x0, Bumper, position),                              // 0x0      0xC    Position (X, Y, Z)
+	ROTATION(0xC, Bumper, rotation),                                // 0xC      0x8    Rotation (X, Y, Z, Pad)
+	VECTOR_F32(0x14, Bumper, scale),                                // 0x14     0xC    Scale (X, Y, Z)
+} };
+
+#define BANANA_SIZE 0x10
+static const ItemLayout bananaLayout = { BANANA_SIZE, sizeof(Banana), 4, {
+	VECTOR_F32(0x0, Banana, position),                              // 0x0      0xC    Position (X, Y, Z)
+	{ 0xC, ITEM_U32, offsetof(Banana, type) },                      // 0xC      0x4    Banana Type
+} };
+
+// Cones step by what the game's own array is read with, not their full size
+// TODO Cone Radius/Height/Radius (How represent in xml)
+#define CONE_STEP 0x26
+static const ItemLayout coneLayout = { CONE_STEP, sizeof(Cone), 6, {
+	VECTOR_F32(0x0, Cone, position),                                // 0x0      0xC    Position (X, Y, Z)
+	ROTATION(0xC, Cone, rotation),                                  // 0xC      0x8    Rotation (X, Y, Z, Pad)
+} };
+
+#define SPHERE_SIZE 0x14
+static const ItemLayout sphereLayout = { SPHERE_SIZE, sizeof(Sphere), 3, {
+	VECTOR_F32(0x0, Sphere, position),                              // 0x0      0xC    Position (X, Y, Z)
+} };                                                                // 0xC      0x8    Radius/Unknown
+
+#define CYLINDER_SIZE 0x1C
+static const ItemLayout cylinderLayout = { CYLINDER_SIZE, sizeof(Cone), 6, {
+	VECTOR_F32(0x0, Cone, position),                                // 0x0      0xC    Position (X, Y, Z)
+	                                                                // 0xC      0x8    Radius/Height
+	ROTATION(0x14, Cone, rotation),                                 // 0x14     0x8    Rotation (X, Y, Z, Pad)
+} };
+
+#define FALLOUT_VOLUME_SIZE 0x20
+static const ItemLayout falloutVolumeLayout = { FALLOUT_VOLUME_SIZE, sizeof(FalloutVolume), 9, {
+	VECTOR_F32(0x0, FalloutVolume, position),                       // 0x0      0xC    Position (X, Y, Z)
+	VECTOR_F32(0xC, FalloutVolume, scale),                          // 0xC      0xC    Scale (X, Y, Z)
+	ROTATION(0x18, FalloutVolume, rotation),                        // 0x18     0x8    Rotation (X, Y, Z, Pad)
+} };
+
+#define SWITCH_SIZE 0x18
+static const ItemLayout switchLayout = { SWITCH_SIZE, sizeof(Switch), 8, {
+	VECTOR_F32(0x0, Switch, position),                              // 0x0      0xC    Position (X, Y, Z)
+	ROTATION(0xC, Switch, rotation),                                // 0xC      0x6    Rotation (X, Y, Z)
+	{ ITEM_SHORT(0x12), ITEM_U16, offsetof(Switch, type) },         // 0x12     0x2    Switch Type
+	{ ITEM_SHORT(0x14), ITEM_U16, offsetof(Switch, animGroupID) },  // 0x14     0x2    Animation Group ID affected
+} };                                                                // 0x16     0x2    Null
+
+#define KEYFRAME_SIZE 0x14
+static const ItemLayout keyframeLayout = { KEYFRAME_SIZE, sizeof(Keyframe), 3, {
+	{ 0x0, ITEM_U32, offsetof(Keyframe, easing) },                  // 0x0      0x4    Easing
+	{ 0x4, ITEM_F32, offsetof(Keyframe, time) },                    // 0x4      0x4    Time (Seconds)
+	{ 0x8, ITEM_F32, offsetof(Keyframe, value) },                   // 0x8      0x4    Value (Amount: pos, rot, R/G/B, ect)
+} };                                                                // 0xC      0x8    Unknown/Null
+
+#define COLLISION_TRIANGLE_SIZE 0x40
+static const ItemLayout collisionTriangleLayout = { COLLISION_TRIANGLE_SIZE, sizeof(CollisionTriangle), 13, {
+	VECTOR_F32(0x0, CollisionTriangle, position),                   // 0x0      0xC    Vertex 1 (X, Y, Z)
+	VECTOR_F32(0xC, CollisionTriangle, normal),                     // 0xC      0xC    Normal (X, Y, Z)
+	ROTATION(0x18, CollisionTriangle, rotation),                    // 0x18     0x6    Rotation from the XY plane (X, Y, Z)
+	                                                                // 0x1E     0x2    Flags
+	{ 0x20, ITEM_F32, offsetof(CollisionTriangle, vertex2X) },      // 0x20     0x4    Vertex 2 X from vertex 1 (before rotation)
+	{ 0x24, ITEM_F32, offsetof(CollisionTriangle, vertex2Y) },      // 0x24     0x4    Vertex 2 Y from vertex 1 (before rotation)
+	{ 0x28, ITEM_F32, offsetof(CollisionTriangle, vertex3X) },      // 0x28     0x4    Vertex 3 X from vertex 1 (before rotation)
+	{ 0x2C, ITEM_F32, offsetof(CollisionTriangle, vertex3Y) },      // 0x2C     0x4    Vertex 3 Y from vertex 1 (before rotation)
+} };                                                                // 0x30     0x10   Edge tangents (unused here)
+
+#undef VECTOR_F32
+#undef ROTATION
 
 // Config Helper Functions
-static ConfigObject readItem(FILE *input);
-static VectorF32 readVectorF32(FILE *input);
-static VectorI16 readVectorI16(FILE *input, int eatPadding);
 static VectorF32 convertRot16ToF32(VectorI16 rotOriginal);
-static CollisionGroupHeader readCollisionGroupHeader(FILE *input);
-static int getWormholeIndex(uint32_t offset);
-
-// XML Buddy Helper Functions
-static void writeAsciiName(FILE *input, XMLBuddy *xmlBuddy, uint32_t nameOffset);
-
-// Config Parser Functions
-static void copyStartPositions(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyFalloutPlane(FILE *input, XMLBuddy *xmlBuddy, uint32_t offset);
-static void copyBackgroundModels(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyBackgroundAnimationOne(FILE *input, XMLBuddy *xmlBuddy, uint32_t animOffset);
-static void copyFog(FILE *input, XMLBuddy *xmlBuddy, uint32_t fogOffset, uint32_t fogAnimOffset);
-static void copyFogAnimation(FILE *input, XMLBuddy *xmlBuddy, uint32_t fogAnimOffset);
-static void copyCollisionFields(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyFieldAnimationType(FILE *input, XMLBuddy *xmlBuddy, enum TAG_TYPE tagType, ConfigObject animData);
-static void copyFieldAnimation(FILE *input, XMLBuddy *xmlBuddy, uint32_t animHeaderOffset);
-static void copyCollisionGroup(FILE *input, XMLBuddy *xmlBuddy, CollisionGroupHeader item);
-static void copyGoals(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyBumpers(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyJamabars(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyBananas(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyCones(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copySpheres(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyCylinders(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyFalloutVolumes(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyReflectiveModels(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyLevelModelInstances(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyLevelModelBs(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copySwitches(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-static void copyWormholes(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item);
-
-static uint32_t wormHoleOffsets[MAX_NUM_WORMHOLES] = { 0 };
-static int wormholeCount = 0;
-
-void extractConfig(char *filename, int game) {
+static int getWormholeIndex(OffsetMap *names, uint32_t offset);
+static uint32_t itemsInStage(StageCursor input, uint32_t number, uint32_t stride);
+static void *parserAlloc(StageParser *parser, uint32_t count, size_t size);
+static void resolveWormholeNames(StageModel *model);
+static const char *readAsciiName(StageParser *parser, uint32_t nameOffset);
+static int initTrackCache(TrackCache *cache, int shared);
+static void freeTrackCache(TrackCache *cache);
+static int findTrack(TrackCache *cache, ConfigObject animData, KeyframeTrack *track);
+static void addTrack(TrackCache *cache, ConfigObject animData, const KeyframeTrack *track);
+static void buildCollisionMesh(CollisionMesh *mesh, const CollisionTriangle *triangles);
+
+// Big endian (SMB2)
+#define ENDIAN_SUFFIX Big
+#define STAGE_BIG_ENDIAN 1
+#define readInt cursorReadBigInt
+#define readShort cursorReadBigShort
+#define readFloat cursorReadBigFloat
+#include "configExtractorImpl.h"
+#undef ENDIAN_SUFFIX
+#undef STAGE_BIG_ENDIAN
+#undef readInt
+#undef readShort
+#undef readFloat
+
+// Little endian (SMBX)
+#define ENDIAN_SUFFIX Little
+#define STAGE_BIG_ENDIAN 0
+#define readInt cursorReadLittleInt
+#define readShort cursorReadLittleShort
+#define readFloat cursorReadLittleFloat
+#include "configExtractorImpl.h"
+#undef ENDIAN_SUFFIX
+#undef STAGE_BIG_ENDIAN
+#undef readInt
+#undef readShort
+#undef readFloat
+
+int parseStageModel(StageFile *stage, int game, StageModel *model, ThreadPool *pool, int collisionMeshes) {
+	initStageModel(model);
 	if (game != SMB2 && game != SMBX) {
-		return;
-	}
-	FILE *input = fopen(filename, "rb");
-	if (input == NULL) {
-		perror("COuldn't Open File");
-		return;
+		return -1;
 	}
 
-	// Make the output file name
-	char outfileName[512];
-	sscanf(filename, "%507s", outfileName);
-	{
-		int nameLength = (int)strlen(outfileName);
-		outfileName[nameLength++] = '.';
-		outfileName[nameLength++] = 'x';
-		outfileName[nameLength++] = 'm';
-		outfileName[nameLength++] = 'l';
-		outfileName[nameLength++] = '\0';
+	StageParser parser;
+	parser.stage = stageCursor(stage, 0);
+	parser.model = model;
+	// Lazy stages decode as they're read, which can't happen from several threads at once
+	parser.pool = stage->lazy == NULL ? pool : NULL;
+	parser.collisionMeshes = collisionMeshes;
+	parser.error = 0;
+	// Only locked if collision fields are parsed at the same time
+	model->names = createNameTable(parser.pool != NULL);
+	parser.names = model->names;
+	// The keyframes themselves live in the model, the cache only points at them
+	TrackCache tracks;
+	parser.tracks = &tracks;
+	if (parser.names == NULL || initTrackCache(&tracks, parser.pool != NULL) != 0) {
+		freeStageModel(model);
+		return -1;
 	}
 
-	XMLBuddy xmlBuddyObj;
-	XMLBuddy *xmlBuddy = initXMLBuddy(&outfileName[0], &xmlBuddyObj, 0);
-
-	// Init read functions (SMB2 is big endian, SMBX is little endian)
+	// SMB2 is big endian, SMBX is little endian
 	if (game == SMB2) {
-		readInt = &readBigInt;
-		readIntRev = &readLittleInt;
-		readShort = &readBigShort;
-		readShortRev = &readLittleShort;
-		readFloat = &readBigFloat;
-		readFloatRev = &readLittleFloat;
+		parseStageBig(&parser);
 	}
-	else if (game == SMBX) {
-		readInt = &readLittleInt;
-		readIntRev = &readBigInt;
-		readShort = &readLittleShort;
-		readShortRev = &readBigShort;
-		readFloat = &readLittleFloat;
-		readFloat = &readBigFloat;
+	else {
+		parseStageLittle(&parser);
 	}
+	freeTrackCache(&tracks);
 
-	ConfigObject collisionFields;
-	ConfigObject startPositions;
-
-	// Start the initial XML header
-	startTagType(xmlBuddy, TAG_TITLE);
-	addAttrTypeStr(xmlBuddy, ATTR_VERSION, "1.0.0");
-	
-	// Seek to collision headers
-	fseek(input, 0x8, SEEK_SET);
-	//                                                                 Offset   Size   Description
-	collisionFields = readItem(input);                              // 0x8,    0x8    Collision Header
-	startPositions.offset = readInt(input);                         // 0x10    0x4    Offset to start position
-	uint32_t falloutPlaneOffset = readInt(input);                   // 0x14    0x4    Offset to fallout plane
-	fseek(input, 0x58, SEEK_SET);                                   // 0x0     0x58   Seek to background models (From beginning to avoid seeking errors)
-	ConfigObject backgroundModels = readItem(input);                // 0x58    0x8    Bakground Models number/offset
-	fseek(input, 0xB0, SEEK_SET);                                   // 0x0     0xB0   Seek to fog animation Header (From beginning to avoid seeking errors)
-	uint32_t fogAnimationOffset = readInt(input);                   // 0xB0    0x4    Fog Animation Header Offset
-	fseek(input, 0xBC, SEEK_SET);                                   // 0x0     0xBC   Seek to fog offset (From beginning to avoid seeking errors)
-	uint32_t fogOffset = readInt(input);                            // 0xBC    0x4    Fog offset
-
-	// The number of start positions is the fallout Y offset - startPosition offset / sizeof(startPosition)
-	startPositions.number = (falloutPlaneOffset - startPositions.offset) / 0x14;
-	copyStartPositions(input, xmlBuddy, startPositions);
-	copyFalloutPlane(input, xmlBuddy, falloutPlaneOffset);
-	copyBackgroundModels(input, xmlBuddy, backgroundModels);
-	copyFog(input, xmlBuddy, fogOffset, fogAnimationOffset);
-
-	// Skip most other stuff here for now
-	// A lot of it isn't needed (since it is required in collision fields anyways
-	// Backgrounds (and a bit more) will need to be covered though
-	copyCollisionFields(input, xmlBuddy, collisionFields);
-
-
-	endTag(xmlBuddy);
-	fclose(input);
-	closeXMlBuddy(xmlBuddy);
-}
-
-
-static void copyCollisionFields(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_ITEM_GROUP);
-
-		CollisionGroupHeader colGroupHeader;
-		//                                                                 Offset   Size   Description
-		VectorF32 centerOfRotation = readVectorF32(input);              // 0x0      0xC    Center of Rotation (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_ROTATION_CENTER, centerOfRotation);
-		VectorI16 initialRotation = readVectorI16(input, 0);            // 0xC      0x6    Initial Rotation (X, Y, Z)
-		writeVectorI16(xmlBuddy, TAG_INITIAL_ROTATION, initialRotation);
-		uint16_t animSeesawType = readShort(input);                     // 0x12     0x2    Animation Seesaw Type
-		writeAnimSeesawType(xmlBuddy, animSeesawType);
-		uint32_t animHeaderOffset = readInt(input);                     // 0x14     0x4    Animation Header Offset
-		copyFieldAnimation(input, xmlBuddy, animHeaderOffset);
-		VectorF32 conveyorSpeed = readVectorF32(input);                 // 0x18     0xC    Conveyor Speed (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_CONVEYOR_SPEED, conveyorSpeed);
-		colGroupHeader = readCollisionGroupHeader(input);               // 0x24     0x20   Collision Group Data
-		copyCollisionGroup(input, xmlBuddy, colGroupHeader);
-		ConfigObject goals = readItem(input);                           // 0x44     0x8    Goal number/offset
-		copyGoals(input, xmlBuddy, goals);
-		ConfigObject bumpers = readItem(input);                         // 0x4C     0x8    Bumper number/offset
-		copyBumpers(input, xmlBuddy, bumpers);
-		ConfigObject jamabars = readItem(input);                        // 0x54     0x8    Jamabar number/offset
-		copyJamabars(input, xmlBuddy, jamabars);
-		ConfigObject bananas = readItem(input);                         // 0x5C     0x8    Bananas number/offset
-		copyBananas(input, xmlBuddy, bananas);
-		ConfigObject cones = readItem(input);                           // 0x64     0x8    Cones number/offset
-		copyCones(input, xmlBuddy, cones);
-		ConfigObject spheres = readItem(input);                         // 0x6C     0x8    Spheres number/offset
-		copySpheres(input, xmlBuddy, spheres);
-		ConfigObject cylinders = readItem(input);                       // 0x74     0x8    Cylinders number/offset
-		copyCylinders(input, xmlBuddy, cylinders);
-		ConfigObject falloutVolumes = readItem(input);                  // 0x7C     0x8    Fallout Volumes number/offset
-		copyFalloutVolumes(input, xmlBuddy, falloutVolumes);
-		ConfigObject reflectiveModels = readItem(input);                // 0x84     0x8    Reflective models number/offset
-		copyReflectiveModels(input, xmlBuddy, reflectiveModels);
-		ConfigObject levelModelInstances = readItem(input);             // 0x8C     0x8    Level Model Instances number/offset
-		// TODO copy Instances
-		ConfigObject levelModelBs = readItem(input);                    // 0x94     0x8    Level Model B number/offset
-		copyLevelModelBs(input, xmlBuddy, levelModelBs);
-		fseek(input, 0x8, SEEK_CUR);                                    // 0x9C     0x8    Unknown/Null
-		uint16_t animGroupID = readShort(input);                        // 0xA4     0x8    Animation Group ID
-		writeTagWithUInt32Value(xmlBuddy, TAG_ANIM_GROUP_ID, animGroupID);
-		fseek(input, 0x2, SEEK_CUR);                                    // 0xA6     0x2    Null
-		ConfigObject switches = readItem(input);                        // 0xA8     0x8    Switches number/offset
-		copySwitches(input, xmlBuddy, switches);
-		fseek(input, 0x4, SEEK_CUR);                                    // 0xB0     0x4    Unknown/Null
-		fseek(input, 0x4, SEEK_CUR);                                    // 0xB4     0x4    Offset to Mystery 5
-		float seesawSensitivity = readFloat(input);                     // 0xB8     0x4    Seesaw Sensitivity
-		writeTagWithFloatValue(xmlBuddy, TAG_SEESAW_SENSITIVITY, seesawSensitivity);
-		float seesawStiffness = readFloat(input);                       // 0xBC     0x4    Seesaw Stiffness
-		writeTagWithFloatValue(xmlBuddy, TAG_SEESAW_STIFFNESS, seesawStiffness);
-		float seesawBounds = readFloat(input);                          // 0xC0     0x4    Seesaw Bounds
-		writeTagWithFloatValue(xmlBuddy, TAG_SEESAW_BOUNDS, seesawBounds);
-		ConfigObject wormholes = readItem(input);                       // 0xC4     0x8    Wormholes number/offset
-		copyWormholes(input, xmlBuddy, wormholes);
-		uint32_t initialAnimState = readInt(input);                     // 0xCC     0x4    Initial Animation State
-		writeAnimType(xmlBuddy, TAG_ANIM_INITIAL_STATE, (uint16_t)initialAnimState);
-		fseek(input, 0x4, SEEK_CUR);                                    // 0xD0     0x4    Unknown/Null
-		float animationLoopPoint = readFloat(input);                    // 0xD4     0x4    Animation Loop Point
-		writeTagWithFloatValue(xmlBuddy, TAG_ANIM_LOOP_TIME, animationLoopPoint);
-		fseek(input, 0x4, SEEK_CUR);                                    // 0xD8     0x4    Offset to Mystery 11
-		fseek(input, 0x3C0, SEEK_CUR);                                  // 0xDC     0x3C0  Unknown/Null
-		endTag(xmlBuddy);
+	if (parser.error) {
+		freeStageModel(model);
+		return -1;
 	}
-	fseek(input, savePos, SEEK_SET);
+	resolveWormholeNames(model);
+	return 0;
 }
 
-static void copyStartPositions(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_START);
-		//                                                                 Offset   Size   Description
-		VectorF32 position = readVectorF32(input);                      // 0x0      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		VectorI16 rotOriginal = readVectorI16(input, 1);                // 0xC      0x8    Rotation (X, Y, Z, Pad)
-		VectorF32 rotation = convertRot16ToF32(rotOriginal);
-		writeVectorF32(xmlBuddy, TAG_ROTATION, rotation);
-
-		endTag(xmlBuddy);
+int extractConfig(StageFile *input, const char *filename, int game, ThreadPool *pool, int writeCollision) {
+	StageModel model;
+	if (parseStageModel(input, game, &model, pool, writeCollision) != 0) {
+		return -1;
 	}
-	fseek(input, savePos, SEEK_SET);
-}
 
-static void copyFalloutPlane(FILE *input, XMLBuddy *xmlBuddy, uint32_t offset) {
-	if (offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, offset, SEEK_SET);
-	//                                                                 Offset   Size   Description
-	float falloutPlane = readFloat(input);                          // 0x0      0x4    Fallout Y position
-	startTagType(xmlBuddy, TAG_FALLOUT_PLANE);
-	addAttrTypeDouble(xmlBuddy, ATTR_Y, falloutPlane);
-	endTag(xmlBuddy);
-
-	fseek(input, savePos, SEEK_SET);
-}
-
-static void copyBackgroundModels(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_BACKGROUND_MODEL);
-		//                                                                 Offset   Size   Description
-		fseek(input, 0x4, SEEK_CUR);                                    // 0x0      0x4    0x0000001F
-		uint32_t asciiNameOffset = readInt(input);                      // 0x4      0x4    Offset to model name
-		startTagType(xmlBuddy, TAG_NAME);
-		writeAsciiName(input, xmlBuddy, asciiNameOffset);
-		endTag(xmlBuddy);
-		fseek(input, 0x4, SEEK_CUR);                                    // 0x8      0x4    Null
-		VectorF32 position = readVectorF32(input);                      // 0xC      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		VectorI16 rotOriginal = readVectorI16(input, 1);                // 0x18      0x8    Rotation (X, Y, Z, Pad)
-		VectorF32 rotation = convertRot16ToF32(rotOriginal);
-		writeVectorF32(xmlBuddy, TAG_ROTATION, rotation);
-		VectorF32 scale = readVectorF32(input);                         // 0x20    0xC     Scale (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_SCALE, scale);
-		uint32_t animOneOffset = readInt(input);                        // 0x2C    0x4     Offset to the first background animation header
-		copyBackgroundAnimationOne(input, xmlBuddy, animOneOffset);
-		uint32_t animTwoOffset = readInt(input);                        // 0x30    0x4     Offset to the second background animation header
-		uint32_t effectHeader = readInt(input);                         // 0x34    0x4     Offset to effect header
+	// Make the output file name
+	char outfileName[OUTPUT_NAME_SIZE];
+	XMLBuddy xmlBuddyObj;
+	XMLBuddy *xmlBuddy = NULL;
+	if (makeOutputName(outfileName, sizeof(outfileName), filename, ".xml") == 0) {
+		xmlBuddy = initXMLBuddy(&outfileName[0], &xmlBuddyObj, 0);
+	}
+	if (xmlBuddy != NULL) {
+		// Start the initial XML header
+		startTagType(xmlBuddy, TAG_TITLE);
+		addAttrTypeStr(xmlBuddy, ATTR_VERSION, "1.0.0");
+		writeStageModelXML(&model, xmlBuddy, pool);
 		endTag(xmlBuddy);
+		closeXMlBuddy(xmlBuddy);
 	}
-	fseek(input, savePos, SEEK_SET);
-}
-
-static void copyBackgroundAnimationOne(FILE *input, XMLBuddy *xmlBuddy, uint32_t animOffset) {
-	if (animOffset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, animOffset, SEEK_SET);
-
-	//                                                                 Offset   Size   Description
-	fseek(input, 0x4, SEEK_CUR);                                    // 0x0      0x4    Unknown/Null
-	float animLoopPoint = readFloat(input);                      // 0x4      0x4    Animation loop point
-	writeTagWithFloatValue(xmlBuddy, TAG_ANIM_LOOP_TIME, animLoopPoint);
-	fseek(input, 0x8, SEEK_CUR);                                    // 0x8      0x8    Unknown/Null
-
-	ConfigObject rotX = readItem(input);                            // 0x10     0x8    Rotation X Anim Data (Number, offset)
-	ConfigObject rotY = readItem(input);                            // 0x18     0x8    Rotation Y Anim Data (Number, offset)
-	ConfigObject rotZ = readItem(input);                            // 0x20     0x8    Rotation Z Anim Data (Number, offset)
-	ConfigObject posX = readItem(input);                            // 0x28     0x8    Translation X Anim Data (Number, offset)
-	ConfigObject posY = readItem(input);                            // 0x30     0x8    Translation Y Anim Data (Number, offset)
-	ConfigObject posZ = readItem(input);                            // 0x38     0x8    Translation Z Anim Data (Number, offset)
-	fseek(input, 0x10, SEEK_CUR);                                   // 0x40     0x10   Unknown/Null
-
-	startTagType(xmlBuddy, TAG_ANIM_KEYFRAMES);
-	copyFieldAnimationType(input, xmlBuddy, TAG_ROT_X, rotX);
-	copyFieldAnimationType(input, xmlBuddy, TAG_ROT_Y, rotY);
-	copyFieldAnimationType(input, xmlBuddy, TAG_ROT_Z, rotZ);
-	copyFieldAnimationType(input, xmlBuddy, TAG_POS_X, posX);
-	copyFieldAnimationType(input, xmlBuddy, TAG_POS_Y, posY);
-	copyFieldAnimationType(input, xmlBuddy, TAG_POS_Z, posZ);
-	endTag(xmlBuddy);
-
-	fseek(input, savePos, SEEK_SET);
-}
-
-static void copyFog(FILE *input, XMLBuddy *xmlBuddy, uint32_t fogOffset, uint32_t fogAnimOffset) {
-	if (fogOffset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, fogOffset, SEEK_SET);
+	int result = xmlBuddy != NULL ? 0 : -1;
 
-	// Deal with main fog header first
-	startTagType(xmlBuddy, TAG_FOG);
-	//                                                                 Offset   Size   Description
-	uint8_t fogType = (uint8_t)fgetc(input);                        // 0x0      0x1    Fog Type
-	writeFogType(xmlBuddy, fogType);
-	fseek(input, 0x3, SEEK_CUR);                                    // 0x1      0x3    Null
-	float fogStart = readFloat(input);                              // 0x4      0x4    Fog start distance
-	writeTagWithFloatValue(xmlBuddy, TAG_START, fogStart);
-	float fogEnd = readFloat(input);                                // 0x8      0x4    Fog end distance
-	writeTagWithFloatValue(xmlBuddy, TAG_END, fogEnd);
-	float red = readFloat(input);                                   // 0xC      0x4    Amount of Red
-	writeTagWithFloatValue(xmlBuddy, TAG_RED, red);
-	float green = readFloat(input);                                 // 0x10     0x4    Amount of Green
-	writeTagWithFloatValue(xmlBuddy, TAG_GREEN, green);
-	float blue = readFloat(input);                                  // 0x14     0x4    Amount of Blue
-	writeTagWithFloatValue(xmlBuddy, TAG_BLUE, blue);
-	fseek(input, 0xC, SEEK_CUR);                                    // 0x18     0xC    Unknown/Null
-	copyFogAnimation(input, xmlBuddy, fogAnimOffset);
-
-	endTag(xmlBuddy);
-	fseek(input, savePos, SEEK_SET);
-}
-
-static void copyFogAnimation(FILE *input, XMLBuddy *xmlBuddy, uint32_t fogAnimOffset) {
-	if (fogAnimOffset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, fogAnimOffset, SEEK_SET);
-
-	//                                                                 Offset   Size   Description
-	ConfigObject startDist = readItem(input);                       // 0x0      0x8    Start Distance Anim Data (Number, offset)
-	ConfigObject endDist = readItem(input);                         // 0x8      0x8    End Distance Anim Data (Number, offset)
-	ConfigObject red = readItem(input);                             // 0x10     0x8    Red Anim Data (Number, offset)
-	ConfigObject green = readItem(input);                           // 0x18     0x8    Green Anim Data (Number, offset)
-	ConfigObject blue = readItem(input);                            // 0x20     0x8    Blue Anim Data (Number, offset)
-	fseek(input, 0x8, SEEK_CUR);                                    // 0x28     0x8    Unknown Anim Data (Number, offset)
-
-	startTagType(xmlBuddy, TAG_ANIM_KEYFRAMES);
-	copyFieldAnimationType(input, xmlBuddy, TAG_START, startDist);
-	copyFieldAnimationType(input, xmlBuddy, TAG_END, endDist);
-	copyFieldAnimationType(input, xmlBuddy, TAG_RED, red);
-	copyFieldAnimationType(input, xmlBuddy, TAG_GREEN, green);
-	copyFieldAnimationType(input, xmlBuddy, TAG_BLUE, blue);
-	endTag(xmlBuddy);
-
-	fseek(input, savePos, SEEK_SET);
-}
-
-static void copyFieldAnimation(FILE *input, XMLBuddy *xmlBuddy, uint32_t animHeaderOffset) {
-	if (animHeaderOffset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, animHeaderOffset, SEEK_SET);
-
-	//                                                                 Offset   Size   Description
-	ConfigObject rotX = readItem(input);                            // 0x0      0x8    Rotation X Anim Data (Number, offset)
-	ConfigObject rotY = readItem(input);                            // 0x8      0x8    Rotation Y Anim Data (Number, offset)
-	ConfigObject rotZ = readItem(input);                            // 0x10     0x8    Rotation Z Anim Data (Number, offset)
-	ConfigObject posX = readItem(input);                            // 0x18     0x8    Translation X Anim Data (Number, offset)
-	ConfigObject posY = readItem(input);                            // 0x20     0x8    Translation Y Anim Data (Number, offset)
-	ConfigObject posZ = readItem(input);                            // 0x28     0x8    Translation Z Anim Data (Number, offset)
-
-	startTagType(xmlBuddy, TAG_ANIM_KEYFRAMES);
-	copyFieldAnimationType(input, xmlBuddy, TAG_ROT_X, rotX);
-	copyFieldAnimationType(input, xmlBuddy, TAG_ROT_Y, rotY);
-	copyFieldAnimationType(input, xmlBuddy, TAG_ROT_Z, rotZ);
-	copyFieldAnimationType(input, xmlBuddy, TAG_POS_X, posX);
-	copyFieldAnimationType(input, xmlBuddy, TAG_POS_Y, posY);
-	copyFieldAnimationType(input, xmlBuddy, TAG_POS_Z, posZ);
-	endTag(xmlBuddy);
-
-	fseek(input, savePos, SEEK_SET);
-}
-
-static void copyFieldAnimationType(FILE *input, XMLBuddy *xmlBuddy, enum TAG_TYPE tagType, ConfigObject animData) {
-	if (animData.number == 0) return;
-	long savePos = ftell(input);
-	fseek(input, animData.offset, SEEK_SET);
-	startTagType(xmlBuddy, tagType);
-
-	for (uint32_t i = 0; i < animData.number; i++) {
-		//                                                                 Offset   Size   Description
-		uint32_t easing = readInt(input);                               // 0x0      0x4    Easing
-		float time = readFloat(input);                                  // 0x4      0x4    Time (Seconds)
-		float value = readFloat(input);                                 // 0x8      0x4    Value (Amount: pos, rot, R/G/B, ect)
-		fseek(input, 0x8, SEEK_CUR);                                    // 0xC      0x8    Unknown/Null
-		startTagType(xmlBuddy, TAG_KEYFRAME);
-		addAttrTypeDouble(xmlBuddy, ATTR_TIME, time);
-		addAttrTypeDouble(xmlBuddy, ATTR_VALUE, value);
-		writeAnimEasingVal(xmlBuddy, easing);
-
-		endTag(xmlBuddy);
+	if (writeCollision && result == 0) {
+		result = makeOutputName(outfileName, sizeof(outfileName), filename, ".ply") == 0 ? writeStageModelPLY(&model, outfileName) : -1;
 	}
 
-	endTag(xmlBuddy);
-	fseek(input, savePos, SEEK_SET);
+	freeStageModel(&model);
+	return result;
 }
 
-static void copyCollisionGroup(FILE *input, XMLBuddy *xmlBuddy, CollisionGroupHeader item) {
-	// TODO Possibly look at collision data
-	// and move this into separate write function)
-	startTagType(xmlBuddy, TAG_COLLISION_GRID);
-
-	startTagType(xmlBuddy, TAG_START);
-	addAttrTypeDouble(xmlBuddy, ATTR_X, item.gridStartX);
-	addAttrTypeDouble(xmlBuddy, ATTR_Z, item.gridStartZ);
-	endTag(xmlBuddy);
-
-	startTagType(xmlBuddy, TAG_STEP);
-	addAttrTypeDouble(xmlBuddy, ATTR_X, item.gridStepX);
-	addAttrTypeDouble(xmlBuddy, ATTR_Z, item.gridStepZ);
-	endTag(xmlBuddy);
-
-	startTagType(xmlBuddy, TAG_COUNT);
-	addAttrTypeDouble(xmlBuddy, ATTR_X, item.gridStepXCount);
-	addAttrTypeDouble(xmlBuddy, ATTR_Z, item.gridStepZCount);
-	endTag(xmlBuddy);
-
-	endTag(xmlBuddy);
+static VectorF32 convertRot16ToF32(VectorI16 rotOriginal) {
+	VectorF32 rotation;
+	rotation.x = convertRotation(rotOriginal.x);
+	rotation.y = convertRotation(rotOriginal.y);
+	rotation.z = convertRotation(rotOriginal.z);
+	return rotation;
 }
 
-static void copyGoals(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_GOAL);
-		//                                                                 Offset   Size   Description
-		VectorF32 position = readVectorF32(input);                      // 0x0      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		VectorI16 rotOriginal = readVectorI16(input, 0);                // 0xC      0x6    Rotation (X, Y, Z)
-		VectorF32 rotation = convertRot16ToF32(rotOriginal);
-		writeVectorF32(xmlBuddy, TAG_ROTATION, rotation);
-		uint16_t goalType = readShort(input);                          // 0x12     0x2     Goal Type
-		writeGoalType(xmlBuddy, goalType);
-		endTag(xmlBuddy);
+// Returns -1 if the slots couldn't grow
+static int getWormholeIndex(OffsetMap *names, uint32_t offset) {
+	OffsetKey key = { offset, 1 };
+	int added;
+	WormholeSlot *slot = addOffsetSlot(names, key, &added);
+	if (slot == NULL) return -1;
+	if (added) {
+		slot->name = (int)names->count - 1;
 	}
-	fseek(input, savePos, SEEK_SET);
+	return slot->name;
 }
 
-static void copyBumpers(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_BUMPER);
-		//                                                                 Offset   Size   Description
-		VectorF32 position = readVectorF32(input);                      // 0x0      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		VectorI16 rotOriginal = readVectorI16(input, 1);                // 0xC      0x8    Rotation (X, Y, Z, Pad)
-		VectorF32 rotation = convertRot16ToF32(rotOriginal);
-		writeVectorF32(xmlBuddy, TAG_ROTATION, rotation);
-		VectorF32 scale = readVectorF32(input);                         // 0x14    0xC     Scale (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_SCALE, scale);
-
-		endTag(xmlBuddy);
-	}
-	fseek(input, savePos, SEEK_SET);
+// Items of an array that start inside the stage, any after those would only read as zeros
+static uint32_t itemsInStage(StageCursor input, uint32_t number, uint32_t stride) {
+	if (!cursorInRange(input)) return 0;
+	uint32_t available = input.stage->size - input.offset;
+	uint32_t count = (available - 1) / stride + 1;
+	return number < count ? number : count;
 }
 
-static void copyJamabars(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_JAMABAR);
-		//                                                                 Offset   Size   Description
-		VectorF32 position = readVectorF32(input);                      // 0x0      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		VectorI16 rotOriginal = readVectorI16(input, 1);                // 0xC      0x8    Rotation (X, Y, Z, Pad)
-		VectorF32 rotation = convertRot16ToF32(rotOriginal);
-		writeVectorF32(xmlBuddy, TAG_ROTATION, rotation);
-		VectorF32 scale = readVectorF32(input);                         // 0x14    0xC     Scale (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_SCALE, scale);
-
-		endTag(xmlBuddy);
+static void *parserAlloc(StageParser *parser, uint32_t count, size_t size) {
+	if (count == 0) return NULL;
+	void *items = NULL;
+	if (count <= SIZE_MAX / size) {
+		items = stageModelAlloc(parser->model, count * size);
 	}
-	fseek(input, savePos, SEEK_SET);
-}
-
-static void copyBananas(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_BANANA);
-		//                                                                 Offset   Size   Description
-		VectorF32 position = readVectorF32(input);                      // 0x0      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		uint32_t bananaType = readInt(input);                           // 0xC      0x4    Banana Type
-		writeBananaType(xmlBuddy, bananaType);
-		endTag(xmlBuddy);
+	if (items == NULL) {
+		parser->error = 1;
 	}
-	fseek(input, savePos, SEEK_SET);
+	return items;
 }
 
-static void copyCones(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_CONE);
-		//                                                                 Offset   Size   Description
-		VectorF32 position = readVectorF32(input);                      // 0x0      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		VectorI16 rotOriginal = readVectorI16(input, 1);                // 0xC      0x8    Rotation (X, Y, Z, Pad)
-		VectorF32 rotation = convertRot16ToF32(rotOriginal);
-		writeVectorF32(xmlBuddy, TAG_ROTATION, rotation);
-		// TODO Cone Radius/Height/Radius (How represent in xml)
-		// TO For implementing sphere and cylinder as well
-		fseek(input, 0x12, SEEK_CUR);
-		endTag(xmlBuddy);
+// Wormholes are named in the order they're first seen, going through the fields in order
+// Names start from 0 again for every stage
+static void resolveWormholeNames(StageModel *model) {
+	// Every wormhole brings at most two new offsets
+	uint64_t offsetCount = 0;
+	for (uint32_t i = 0; i < model->collisionFieldCount; i++) {
+		offsetCount += (uint64_t)model->collisionFields[i].wormholeCount * 2;
 	}
-	fseek(input, savePos, SEEK_SET);
-}
-
-static void copySpheres(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_SPHERE);
-		//                                                                 Offset   Size   Description
-		VectorF32 position = readVectorF32(input);                      // 0x0      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		// TODO Cone Radius/Height/Radius (How represent in xml)
-		// TO For implementing sphere and cylinder as well
-		fseek(input, 0x8, SEEK_CUR);
-		endTag(xmlBuddy);
+	if (offsetCount == 0) return;
+	OffsetMap names;
+	int namesReady = offsetCount <= UINT32_MAX && initOffsetMap(&names, sizeof(WormholeSlot), (uint32_t)offsetCount) == 0;
+
+	for (uint32_t i = 0; i < model->collisionFieldCount; i++) {
+		CollisionField *field = &model->collisionFields[i];
+		for (uint32_t j = 0; j < field->wormholeCount; j++) {
+			Wormhole *wormhole = &field->wormholes[j];
+			// Without memory for the slots every name is -1
+			wormhole->name = namesReady ? getWormholeIndex(&names, wormhole->offset) : -1;
+			wormhole->destinationName = namesReady ? getWormholeIndex(&names, wormhole->destinationOffset) : -1;
+		}
 	}
-	fseek(input, savePos, SEEK_SET);
-}
-
-static void copyCylinders(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_CYLINDER);
-		//                                                                 Offset   Size   Description
-		VectorF32 position = readVectorF32(input);                      // 0x0      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		// TODO Cone Radius/Height/Radius (How represent in xml)
-		// TO For implementing sphere and cylinder as well
-		fseek(input, 8, SEEK_CUR);
-		VectorI16 rotOriginal = readVectorI16(input, 1);                // 0xC      0x8    Rotation (X, Y, Z, Pad)
-		VectorF32 rotation = convertRot16ToF32(rotOriginal);
-		writeVectorF32(xmlBuddy, TAG_ROTATION, rotation);
-		endTag(xmlBuddy);
+	if (namesReady) {
+		freeOffsetMap(&names);
 	}
-	fseek(input, savePos, SEEK_SET);
 }
 
-static void copyFalloutVolumes(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_FALLOUT_VOLUME);
-		//                                                                 Offset   Size   Description
-		VectorF32 position = readVectorF32(input);                      // 0x0      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		VectorF32 scale = readVectorF32(input);                         // 0xC      0xC    Scale (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_SCALE, scale);
-		VectorI16 rotOriginal = readVectorI16(input, 1);                // 0x18     0x8    Rotation (X, Y, Z, Pad)
-		VectorF32 rotation = convertRot16ToF32(rotOriginal);
-		writeVectorF32(xmlBuddy, TAG_ROTATION, rotation);
-
-		endTag(xmlBuddy);
+// Models share names, so each offset is only read once and later reads get the same copy
+static const char *readAsciiName(StageParser *parser, uint32_t nameOffset) {
+	if (nameOffset == 0) return NULL;
+	const char *name = findName(parser->names, nameOffset);
+	if (name != NULL) return name;
+
+	// Up to the terminator or 255 characters, whatever of that is in the stage
+	StageFile *stage = parser->stage.stage;
+	uint32_t span = stageResidentSpan(stage, nameOffset, 255);
+	uint32_t length = 0;
+	const char *start = "";
+	if (span > 0) {
+		start = (const char *)stage->data + nameOffset;
+		const char *end = memchr(start, 0, span);
+		length = end != NULL ? (uint32_t)(end - start) : span;
 	}
-	fseek(input, savePos, SEEK_SET);
-}
 
-static void copyReflectiveModels(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_REFLECTIVE_MODEL);
-		//                                                                 Offset   Size   Description
-		uint32_t nameOffset = readInt(input);                           // 0x0      0x4    Name offset
-		writeAsciiName(input, xmlBuddy, nameOffset);
-		fseek(input, 0x4, SEEK_CUR);                                    // 0x4      0x4    Null
-		endTag(xmlBuddy);
+	name = addName(parser->names, nameOffset, start, length);
+	if (name == NULL) {
+		parser->error = 1;
 	}
-	fseek(input, savePos, SEEK_SET);
+	return name;
 }
 
-static void copyLevelModelBs(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_LEVEL_MODEL);
-		//                                                                 Offset   Size   Description
-		                                                                 // Level Model B
-		uint32_t levelModelAPointerOffset = readInt(input);             // 0x0      0x4    Offset to the Level Model A Pointer
-		long savePos2 = ftell(input);
-		fseek(input, levelModelAPointerOffset, SEEK_SET);
-		                                                                // Level Model A Pointer
-		fseek(input, 0x8, SEEK_CUR);                                    // 0x0      0x8    0x0000000000000001
-		uint32_t levelModelAOffset = readInt(input);                    // 0x8      0x4    Offset to Level Model A
-		fseek(input, levelModelAOffset, SEEK_SET);
-		                                                                 // Level Model A
-		fseek(input, 0x4, SEEK_CUR);                                    // 0x0      0x4    Null
-		uint32_t levelModelNameOffset = readInt(input);
-		writeAsciiName(input, xmlBuddy, levelModelNameOffset);
-
-		fseek(input, savePos2, SEEK_SET);
-		endTag(xmlBuddy);
+static int initTrackCache(TrackCache *cache, int shared) {
+	int slotsReady = initOffsetMap(&cache->slots, sizeof(TrackSlot), 32) == 0;
+	cache->lock = shared ? createThreadLock() : NULL;
+	if (!slotsReady || (shared && cache->lock == NULL)) {
+		freeTrackCache(cache);
+		return -1;
 	}
-	fseek(input, savePos, SEEK_SET);
+	return 0;
 }
 
-static void copySwitches(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_SWITCH);
-		//                                                                 Offset   Size   Description
-		VectorF32 position = readVectorF32(input);                      // 0x0      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		VectorI16 rotOriginal = readVectorI16(input, 0);                // 0xC      0x6    Rotation (X, Y, Z)
-		VectorF32 rotation = convertRot16ToF32(rotOriginal);
-		writeVectorF32(xmlBuddy, TAG_ROTATION, rotation);
-		uint16_t switchType = readShort(input);                         // 0x12     0x2    Switch Type
-		writeAnimType(xmlBuddy, TAG_TYPE, switchType);
-		uint16_t animGroupIDAffected = readShort(input);                // 0x14     0x2    Animation Group ID affected
-		startTagType(xmlBuddy, TAG_ANIM_GROUP_ID);
-		addValUInt32(xmlBuddy, (uint32_t)animGroupIDAffected);
-		endTag(xmlBuddy);
-		fseek(input, 0x2, SEEK_CUR);                                    // 0x16     0x2    Null
-
-		endTag(xmlBuddy);
-	}
-	fseek(input, savePos, SEEK_SET);
+static void freeTrackCache(TrackCache *cache) {
+	freeOffsetMap(&cache->slots);
+	destroyThreadLock(cache->lock);
+	cache->lock = NULL;
 }
 
-static void copyWormholes(FILE *input, XMLBuddy *xmlBuddy, ConfigObject item) {
-	if (item.number == 0 || item.offset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, item.offset, SEEK_SET);
-
-	for (uint32_t i = 0; i < item.number; i++) {
-		startTagType(xmlBuddy, TAG_WORMHOLE);
-		uint32_t offset = (uint32_t)ftell(input);
-		int wormHoleIndex = getWormholeIndex(offset);
-		writeTagWithInt32Value(xmlBuddy, TAG_NAME, wormHoleIndex);
-		//                                                                 Offset   Size   Description
-		fseek(input, 0x4, SEEK_CUR);                                    // 0x0      0x4    0x00000001
-		VectorF32 position = readVectorF32(input);                      // 0x4      0xC    Position (X, Y, Z)
-		writeVectorF32(xmlBuddy, TAG_POSITION, position);
-		VectorI16 rotOriginal = readVectorI16(input, 1);                // 0x10     0x8    Rotation (X, Y, Z, Padd)
-		VectorF32 rotation = convertRot16ToF32(rotOriginal);
-		writeVectorF32(xmlBuddy, TAG_ROTATION, rotation);
-		uint32_t destOffset = readInt(input);                           // 0x18     0x4    Offset to destination wormhole
-		int destWormholeIndex = getWormholeIndex(destOffset);
-		writeTagWithInt32Value(xmlBuddy, TAG_DESTINATION_NAME, destWormholeIndex);
-		endTag(xmlBuddy);
+static int findTrack(TrackCache *cache, ConfigObject animData, KeyframeTrack *track) {
+	if (animData.offset == 0) return 0;
+	OffsetKey key = { animData.offset, animData.number };
+	if (cache->lock != NULL) acquireThreadLock(cache->lock);
+	const TrackSlot *slot = findOffsetSlot(&cache->slots, key);
+	if (slot != NULL) {
+		*track = slot->track;
 	}
-	fseek(input, savePos, SEEK_SET);
-}
-
-static ConfigObject readItem(FILE *input) {
-	ConfigObject configObject;
-	configObject.number = readInt(input);
-	configObject.offset = readInt(input);
-	return configObject;
-}
-
-static VectorF32 readVectorF32(FILE *input) {
-	VectorF32 vector32;
-	vector32.x = readFloat(input);
-	vector32.y = readFloat(input);
-	vector32.z = readFloat(input);
-	return vector32;
-}
-
-static VectorI16 readVectorI16(FILE *input, int eatPadding) {
-	VectorI16 vector16;
-	vector16.x = readShort(input);
-	vector16.y = readShort(input);
-	vector16.z = readShort(input);
-	if (eatPadding) readShort(input);
-	return vector16;
+	if (cache->lock != NULL) releaseThreadLock(cache->lock);
+	return slot != NULL;
 }
 
-static VectorF32 convertRot16ToF32(VectorI16 rotOriginal) {
-	const double conversionFactor = 360.0 / 65536.0;
-	VectorF32 rotation;
-	rotation.x = (float)(conversionFactor * rotOriginal.x);
-	rotation.y = (float)(conversionFactor * rotOriginal.y);
-	rotation.z = (float)(conversionFactor * rotOriginal.z);
-	return rotation;
-}
-
-static CollisionGroupHeader readCollisionGroupHeader(FILE *input) {
-	CollisionGroupHeader colGroupHeader;
-	//                                                                 Offset   Size   Description
-	colGroupHeader.triangleListOffset = readInt(input);             // 0x0      0x4    Offset to the Collision Triangle List
-	colGroupHeader.gridTriangleListOffet = readInt(input);          // 0x4      0x4    Offset to the Grid Triangle List Pointers
-	colGroupHeader.gridStartX = readFloat(input);                   // 0x8      0x4    Grid Start X
-	colGroupHeader.gridStartZ = readFloat(input);                   // 0xC      0x4    Grid Start Z
-	colGroupHeader.gridStepX = readFloat(input);                    // 0x10     0x4    Grid Step X
-	colGroupHeader.gridStepZ = readFloat(input);                    // 0x14     0x4    Grid Step Z
-	colGroupHeader.gridStepXCount = readInt(input);                 // 0x18     0x4    Grid X Step Count
-	colGroupHeader.gridStepZCount = readInt(input);                 // 0x1C     0x4    Grid Z Steo Count
-	return colGroupHeader;
-}
-
-static int getWormholeIndex(uint32_t offset) {
-	for (int i = 0; i < wormholeCount && i < MAX_NUM_WORMHOLES; i++) {
-		if (wormHoleOffsets[i] == offset) {
-			return i;
-		}
-	}
-	if (wormholeCount == MAX_NUM_WORMHOLES) {
-		return -1;
+// If the slots can't grow the track just isn't remembered
+static void addTrack(TrackCache *cache, ConfigObject animData, const KeyframeTrack *track) {
+	if (animData.offset == 0) return;
+	OffsetKey key = { animData.offset, animData.number };
+	int added;
+	if (cache->lock != NULL) acquireThreadLock(cache->lock);
+	TrackSlot *slot = addOffsetSlot(&cache->slots, key, &added);
+	if (added) {
+		slot->track = *track;
 	}
-	wormHoleOffsets[wormholeCount] = offset;
-	return wormholeCount++;
+	if (cache->lock != NULL) releaseThreadLock(cache->lock);
 }
 
-static void writeAsciiName(FILE *input, XMLBuddy *xmlBuddy, uint32_t nameOffset) {
-	if (nameOffset == 0) return;
-	long savePos = ftell(input);
-	fseek(input, nameOffset, SEEK_SET);
-	char nameBuff[256] = { 0 };
-
-	int index = 0;
-	while (1) {
-		uint8_t c = (uint8_t)fgetc(input);
-		if (feof(input) || c == 0 || index >= 255) break;
-		nameBuff[index++] = c;
+#define DEGREES_TO_RADIANS (3.14159265358979323846f / 180.0f)
+
+// Rotates the two in-plane vertices of every triangle into place, Y * X * Z applied to (X, Y, 0)
+// Split from the decode so the loop only does arithmetic on already decoded floats
+static void buildCollisionMesh(CollisionMesh *mesh, const CollisionTriangle *triangles) {
+	for (uint32_t i = 0; i < mesh->triangleCount; i++) {
+		const CollisionTriangle *triangle = &triangles[i];
+		float sinX = sinf(triangle->rotation.x * DEGREES_TO_RADIANS);
+		float cosX = cosf(triangle->rotation.x * DEGREES_TO_RADIANS);
+		float sinY = sinf(triangle->rotation.y * DEGREES_TO_RADIANS);
+		float cosY = cosf(triangle->rotation.y * DEGREES_TO_RADIANS);
+		float sinZ = sinf(triangle->rotation.z * DEGREES_TO_RADIANS);
+		float cosZ = cosf(triangle->rotation.z * DEGREES_TO_RADIANS);
+
+		// Columns of the rotation for an X and a Y in the plane, Z is always 0
+		VectorF32 xAxis = { cosZ * cosY + sinZ * sinX * sinY, sinZ * cosX, -cosZ * sinY + sinZ * sinX * cosY };
+		VectorF32 yAxis = { -sinZ * cosY + cosZ * sinX * sinY, cosZ * cosX, sinZ * sinY + cosZ * sinX * cosY };
+
+		VectorF32 *vertices = &mesh->vertices[i * 3];
+		vertices[0] = triangle->position;
+		vertices[1].x = triangle->position.x + xAxis.x * triangle->vertex2X + yAxis.x * triangle->vertex2Y;
+		vertices[1].y = triangle->position.y + xAxis.y * triangle->vertex2X + yAxis.y * triangle->vertex2Y;
+		vertices[1].z = triangle->position.z + xAxis.z * triangle->vertex2X + yAxis.z * triangle->vertex2Y;
+		vertices[2].x = triangle->position.x + xAxis.x * triangle->vertex3X + yAxis.x * triangle->vertex3Y;
+		vertices[2].y = triangle->position.y + xAxis.y * triangle->vertex3X + yAxis.y * triangle->vertex3Y;
+		vertices[2].z = triangle->position.z + xAxis.z * triangle->vertex3X + yAxis.z * triangle->vertex3Y;
+		mesh->normals[i] = triangle->normal;
 	}
-	nameBuff[index] = '\0';
-
-	addValStr(xmlBuddy, nameBuff);
-	fseek(input, savePos, SEEK_SET);
-}
\ No newline at end of file
+}
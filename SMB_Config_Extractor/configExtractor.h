@@ -1,2 +1,8 @@
 #pragma once
-void extractConfig(char *filename, int gameVersion);
\ No newline at end of file
+#include "stageFile.h"
+#include "threadPool.h"
+
+// Collision fields are parsed and written on the pool if there is one
+// With writeCollision the collision triangles also go to <filename>.ply
+// Returns -1 if no config was written, or if the triangles were asked for and couldn't be written
+int extractConfig(StageFile *input, const char *filename, int gameVersion, ThreadPool *pool, int writeCollision);
\ No newline at end of file
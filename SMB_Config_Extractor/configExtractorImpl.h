@@ -0,0 +1,506 @@
+// Endian specific half of configExtractor.c, compiled once per byte order
+// The includer defines ENDIAN_SUFFIX, STAGE_BIG_ENDIAN and readInt, readShort and readFloat for that byte order
+
+// Give everything in here a name for this byte order
+#define parseStage ENDIAN_NAME(parseStage)
+#define parseCollisionFields ENDIAN_NAME(parseCollisionFields)
+#define parseCollisionFieldTask ENDIAN_NAME(parseCollisionFieldTask)
+#define parseCollisionField ENDIAN_NAME(parseCollisionField)
+#define parseFalloutPlane ENDIAN_NAME(parseFalloutPlane)
+#define parseBackgroundModels ENDIAN_NAME(parseBackgroundModels)
+#define parseBackgroundAnimationOne ENDIAN_NAME(parseBackgroundAnimationOne)
+#define parseFog ENDIAN_NAME(parseFog)
+#define parseFogAnimation ENDIAN_NAME(parseFogAnimation)
+#define parseFieldAnimation ENDIAN_NAME(parseFieldAnimation)
+#define parseKeyframes ENDIAN_NAME(parseKeyframes)
+#define parseReflectiveModels ENDIAN_NAME(parseReflectiveModels)
+#define parseLevelModelBs ENDIAN_NAME(parseLevelModelBs)
+#define parseWormholes ENDIAN_NAME(parseWormholes)
+#define readItem ENDIAN_NAME(readItem)
+#define readVectorF32 ENDIAN_NAME(readVectorF32)
+#define readVectorI16 ENDIAN_NAME(readVectorI16)
+#define readCollisionGroupHeader ENDIAN_NAME(readCollisionGroupHeader)
+#define readItems ENDIAN_NAME(readItems)
+#define decodeItems ENDIAN_NAME(decodeItems)
+#define parseCollisionMesh ENDIAN_NAME(parseCollisionMesh)
+
+// Config Helper Functions
+static ConfigObject readItem(StageCursor *input);
+static VectorF32 readVectorF32(StageCursor *input);
+static VectorI16 readVectorI16(StageCursor *input, int eatPadding);
+static CollisionGroupHeader readCollisionGroupHeader(StageCursor *input);
+static void *readItems(StageParser *parser, ConfigObject item, const ItemLayout *layout, uint32_t *count);
+static int decodeItems(StageParser *parser, StageCursor input, uint32_t itemCount, const ItemLayout *layout, void *items);
+
+// Config Parser Functions
+static void parseStage(StageParser *parser);
+static void parseCollisionFields(StageParser *parser, ConfigObject item);
+static void parseCollisionFieldTask(void *context, uint32_t index);
+static void parseCollisionField(StageParser *parser, CollisionField *field, StageCursor input);
+static void parseFalloutPlane(StageParser *parser, uint32_t offset);
+static void parseBackgroundModels(StageParser *parser, ConfigObject item);
+static void parseBackgroundAnimationOne(StageParser *parser, BackgroundModel *backgroundModel, uint32_t animOffset);
+static void parseFog(StageParser *parser, uint32_t fogOffset, uint32_t fogAnimOffset);
+static void parseFogAnimation(StageParser *parser, Fog *fog, uint32_t fogAnimOffset);
+static void parseFieldAnimation(StageParser *parser, TransformAnimation *animation, uint32_t animHeaderOffset);
+static void parseKeyframes(StageParser *parser, KeyframeTrack *track, ConfigObject animData);
+static void parseReflectiveModels(StageParser *parser, CollisionField *field, ConfigObject item);
+static void parseLevelModelBs(StageParser *parser, CollisionField *field, ConfigObject item);
+static void parseWormholes(StageParser *parser, CollisionField *field, ConfigObject item);
+static void parseCollisionMesh(StageParser *parser, CollisionMesh *mesh, CollisionGroupHeader grid);
+
+static void parseStage(StageParser *parser) {
+	ConfigObject collisionFields;
+	ConfigObject startPositions;
+
+	// Seek to collision headers
+	StageCursor input = cursorAt(parser->stage, 0x8);
+	//                                                                 Offset   Size   Description
+	collisionFields = readItem(&input);                             // 0x8,    0x8    Collision Header
+	startPositions.offset = readInt(&input);                        // 0x10    0x4    Offset to start position
+	uint32_t falloutPlaneOffset = readInt(&input);                  // 0x14    0x4    Offset to fallout plane
+	input = cursorAt(parser->stage, 0x58);                              // 0x0     0x58   Seek to background models (From beginning to avoid seeking errors)
+	ConfigObject backgroundModels = readItem(&input);               // 0x58    0x8    Bakground Models number/offset
+	input = cursorAt(parser->stage, 0xB0);                              // 0x0     0xB0   Seek to fog animation Header (From beginning to avoid seeking errors)
+	uint32_t fogAnimationOffset = readInt(&input);                  // 0xB0    0x4    Fog Animation Header Offset
+	input = cursorAt(parser->stage, 0xBC);                              // 0x0     0xBC   Seek to fog offset (From beginning to avoid seeking errors)
+	uint32_t fogOffset = readInt(&input);                           // 0xBC    0x4    Fog offset
+
+	// The number of start positions is the fallout Y offset - startPosition offset / sizeof(startPosition)
+	startPositions.number = (falloutPlaneOffset - startPositions.offset) / START_POSITION_SIZE;
+	parser->model->startPositions = readItems(parser, startPositions, &startPositionLayout, &parser->model->startPositionCount);
+	parseFalloutPlane(parser, falloutPlaneOffset);
+	parseBackgroundModels(parser, backgroundModels);
+	parseFog(parser, fogOffset, fogAnimationOffset);
+
+	// Skip most other stuff here for now
+	// A lot of it isn't needed (since it is required in collision fields anyways
+	// Backgrounds (and a bit more) will need to be covered though
+	parseCollisionFields(parser, collisionFields);
+}
+
+static void parseCollisionFields(StageParser *parser, ConfigObject item) {
+	if (item.number == 0 || item.offset == 0) return;
+	StageCursor input = cursorAt(parser->stage, item.offset);
+	uint32_t count = itemsInStage(input, item.number, COLLISION_FIELD_SIZE);
+	CollisionField *fields = parserAlloc(parser, count, sizeof(CollisionField));
+	if (fields == NULL) return;
+	parser->model->collisionFields = fields;
+	parser->model->collisionFieldCount = count;
+
+	CollisionFieldJob job;
+	job.offset = item.offset;
+	job.fields = fields;
+	job.parsers = calloc(count, sizeof(StageParser));
+	job.models = calloc(count, sizeof(StageModel));
+	if (job.parsers == NULL || job.models == NULL) {
+		free(job.parsers);
+		free(job.models);
+		parser->error = 1;
+		return;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		initStageModel(&job.models[i]);
+		job.parsers[i].stage = parser->stage;
+		job.parsers[i].model = &job.models[i];
+		job.parsers[i].pool = NULL;
+		job.parsers[i].names = parser->names;
+		job.parsers[i].tracks = parser->tracks;
+		job.parsers[i].collisionMeshes = parser->collisionMeshes;
+		job.parsers[i].error = 0;
+	}
+
+	runThreadPool(parser->pool, count, parseCollisionFieldTask, &job);
+
+	for (uint32_t i = 0; i < count; i++) {
+		mergeStageModel(parser->model, &job.models[i]);
+		parser->error |= job.parsers[i].error;
+	}
+	free(job.parsers);
+	free(job.models);
+}
+
+static void parseCollisionFieldTask(void *context, uint32_t index) {
+	CollisionFieldJob *job = context;
+	StageParser *parser = &job->parsers[index];
+	StageCursor input = cursorAt(parser->stage, job->offset + index * COLLISION_FIELD_SIZE);
+	parseCollisionField(parser, &job->fields[index], input);
+}
+
+static void parseCollisionField(StageParser *parser, CollisionField *field, StageCursor input) {
+	//                                                                 Offset   Size   Description
+	field->centerOfRotation = readVectorF32(&input);                // 0x0      0xC    Center of Rotation (X, Y, Z)
+	field->initialRotation = readVectorI16(&input, 0);              // 0xC      0x6    Initial Rotation (X, Y, Z)
+	field->animSeesawType = readShort(&input);                      // 0x12     0x2    Animation Seesaw Type
+	uint32_t animHeaderOffset = readInt(&input);                    // 0x14     0x4    Animation Header Offset
+	parseFieldAnimation(parser, &field->animation, animHeaderOffset);
+	field->conveyorSpeed = readVectorF32(&input);                   // 0x18     0xC    Conveyor Speed (X, Y, Z)
+	field->collisionGrid = readCollisionGroupHeader(&input);        // 0x24     0x20   Collision Group Data
+	if (parser->collisionMeshes) {
+		parseCollisionMesh(parser, &field->collisionMesh, field->collisionGrid);
+	}
+	ConfigObject goals = readItem(&input);                          // 0x44     0x8    Goal number/offset
+	field->goals = readItems(parser, goals, &goalLayout, &field->goalCount);
+	ConfigObject bumpers = readItem(&input);                        // 0x4C     0x8    Bumper number/offset
+	field->bumpers = readItems(parser, bumpers, &bumperLayout, &field->bumperCount);
+	ConfigObject jamabars = readItem(&input);                       // 0x54     0x8    Jamabar number/offset
+	field->jamabars = readItems(parser, jamabars, &bumperLayout, &field->jamabarCount);
+	ConfigObject bananas = readItem(&input);                        // 0x5C     0x8    Bananas number/offset
+	field->bananas = readItems(parser, bananas, &bananaLayout, &field->bananaCount);
+	ConfigObject cones = readItem(&input);                          // 0x64     0x8    Cones number/offset
+	field->cones = readItems(parser, cones, &coneLayout, &field->coneCount);
+	ConfigObject spheres = readItem(&input);                        // 0x6C     0x8    Spheres number/offset
+	field->spheres = readItems(parser, spheres, &sphereLayout, &field->sphereCount);
+	ConfigObject cylinders = readItem(&input);                      // 0x74     0x8    Cylinders number/offset
+	field->cylinders = readItems(parser, cylinders, &cylinderLayout, &field->cylinderCount);
+	ConfigObject falloutVolumes = readItem(&input);                 // 0x7C     0x8    Fallout Volumes number/offset
+	field->falloutVolumes = readItems(parser, falloutVolumes, &falloutVolumeLayout, &field->falloutVolumeCount);
+	ConfigObject reflectiveModels = readItem(&input);               // 0x84     0x8    Reflective models number/offset
+	parseReflectiveModels(parser, field, reflectiveModels);
+	cursorSkip(&input, 0x8);                                            // 0x8C     0x8    Level Model Instances number/offset
+	// TODO copy Instances
+	ConfigObject levelModelBs = readItem(&input);                   // 0x94     0x8    Level Model B number/offset
+	parseLevelModelBs(parser, field, levelModelBs);
+	cursorSkip(&input, 0x8);                                            // 0x9C     0x8    Unknown/Null
+	field->animGroupID = readShort(&input);                         // 0xA4     0x8    Animation Group ID
+	cursorSkip(&input, 0x2);                                            // 0xA6     0x2    Null
+	ConfigObject switches = readItem(&input);                       // 0xA8     0x8    Switches number/offset
+	field->switches = readItems(parser, switches, &switchLayout, &field->switchCount);
+	cursorSkip(&input, 0x4);                                            // 0xB0     0x4    Unknown/Null
+	cursorSkip(&input, 0x4);                                            // 0xB4     0x4    Offset to Mystery 5
+	field->seesawSensitivity = readFloat(&input);                   // 0xB8     0x4    Seesaw Sensitivity
+	field->seesawStiffness = readFloat(&input);                     // 0xBC     0x4    Seesaw Stiffness
+	field->seesawBounds = readFloat(&input);                        // 0xC0     0x4    Seesaw Bounds
+	ConfigObject wormholes = readItem(&input);                      // 0xC4     0x8    Wormholes number/offset
+	parseWormholes(parser, field, wormholes);
+	field->initialAnimState = readInt(&input);                      // 0xCC     0x4    Initial Animation State
+	cursorSkip(&input, 0x4);                                            // 0xD0     0x4    Unknown/Null
+	field->animationLoopPoint = readFloat(&input);                  // 0xD4     0x4    Animation Loop Point
+	cursorSkip(&input, 0x4);                                            // 0xD8     0x4    Offset to Mystery 11
+	cursorSkip(&input, 0x3C0);                                          // 0xDC     0x3C0  Unknown/Null
+}
+
+static void parseFalloutPlane(StageParser *parser, uint32_t offset) {
+	if (offset == 0) return;
+	StageCursor input = cursorAt(parser->stage, offset);
+	if (!cursorInRange(input)) return;
+	//                                                                 Offset   Size   Description
+	parser->model->falloutPlane = readFloat(&input);                // 0x0      0x4    Fallout Y position
+	parser->model->falloutPlanePresent = 1;
+}
+
+static void parseBackgroundModels(StageParser *parser, ConfigObject item) {
+	if (item.number == 0 || item.offset == 0) return;
+	StageCursor input = cursorAt(parser->stage, item.offset);
+	uint32_t count = itemsInStage(input, item.number, BACKGROUND_MODEL_SIZE);
+	BackgroundModel *backgroundModels = parserAlloc(parser, count, sizeof(BackgroundModel));
+	if (backgroundModels == NULL) return;
+	parser->model->backgroundModels = backgroundModels;
+	parser->model->backgroundModelCount = count;
+
+	for (uint32_t i = 0; i < count; i++) {
+		BackgroundModel *backgroundModel = &backgroundModels[i];
+		//                                                                 Offset   Size   Description
+		cursorSkip(&input, 0x4);                                            // 0x0      0x4    0x0000001F
+		uint32_t asciiNameOffset = readInt(&input);                     // 0x4      0x4    Offset to model name
+		backgroundModel->name = readAsciiName(parser, asciiNameOffset);
+		cursorSkip(&input, 0x4);                                            // 0x8      0x4    Null
+		backgroundModel->position = readVectorF32(&input);              // 0xC      0xC    Position (X, Y, Z)
+		VectorI16 rotOriginal = readVectorI16(&input, 1);               // 0x18      0x8    Rotation (X, Y, Z, Pad)
+		backgroundModel->rotation = convertRot16ToF32(rotOriginal);
+		backgroundModel->scale = readVectorF32(&input);                 // 0x20    0xC     Scale (X, Y, Z)
+		uint32_t animOneOffset = readInt(&input);                       // 0x2C    0x4     Offset to the first background animation header
+		parseBackgroundAnimationOne(parser, backgroundModel, animOneOffset);
+		cursorSkip(&input, 0x4);                                            // 0x30    0x4     Offset to the second background animation header
+		cursorSkip(&input, 0x4);                                            // 0x34    0x4     Offset to effect header
+	}
+}
+
+static void parseBackgroundAnimationOne(StageParser *parser, BackgroundModel *backgroundModel, uint32_t animOffset) {
+	if (animOffset == 0) return;
+	StageCursor input = cursorAt(parser->stage, animOffset);
+	if (!cursorInRange(input)) return;
+
+	//                                                                 Offset   Size   Description
+	cursorSkip(&input, 0x4);                                            // 0x0      0x4    Unknown/Null
+	backgroundModel->animationLoopTime = readFloat(&input);         // 0x4      0x4    Animation loop point
+	cursorSkip(&input, 0x8);                                            // 0x8      0x8    Unknown/Null
+
+	KeyframeTrack *tracks = backgroundModel->animation.tracks;
+	backgroundModel->animation.present = 1;
+	parseKeyframes(parser, &tracks[TRACK_ROT_X], readItem(&input)); // 0x10     0x8    Rotation X Anim Data (Number, offset)
+	parseKeyframes(parser, &tracks[TRACK_ROT_Y], readItem(&input)); // 0x18     0x8    Rotation Y Anim Data (Number, offset)
+	parseKeyframes(parser, &tracks[TRACK_ROT_Z], readItem(&input)); // 0x20     0x8    Rotation Z Anim Data (Number, offset)
+	parseKeyframes(parser, &tracks[TRACK_POS_X], readItem(&input)); // 0x28     0x8    Translation X Anim Data (Number, offset)
+	parseKeyframes(parser, &tracks[TRACK_POS_Y], readItem(&input)); // 0x30     0x8    Translation Y Anim Data (Number, offset)
+	parseKeyframes(parser, &tracks[TRACK_POS_Z], readItem(&input)); // 0x38     0x8    Translation Z Anim Data (Number, offset)
+	                                                                // 0x40     0x10   Unknown/Null
+}
+
+static void parseFog(StageParser *parser, uint32_t fogOffset, uint32_t fogAnimOffset) {
+	if (fogOffset == 0) return;
+	StageCursor input = cursorAt(parser->stage, fogOffset);
+	if (!cursorInRange(input)) return;
+
+	// Deal with main fog header first
+	Fog *fog = &parser->model->fog;
+	parser->model->fogPresent = 1;
+	//                                                                 Offset   Size   Description
+	fog->type = (uint8_t)cursorGetc(&input);                            // 0x0      0x1    Fog Type
+	cursorSkip(&input, 0x3);                                            // 0x1      0x3    Null
+	fog->start = readFloat(&input);                                 // 0x4      0x4    Fog start distance
+	fog->end = readFloat(&input);                                   // 0x8      0x4    Fog end distance
+	fog->red = readFloat(&input);                                   // 0xC      0x4    Amount of Red
+	fog->green = readFloat(&input);                                 // 0x10     0x4    Amount of Green
+	fog->blue = readFloat(&input);                                  // 0x14     0x4    Amount of Blue
+	                                                                // 0x18     0xC    Unknown/Null
+	parseFogAnimation(parser, fog, fogAnimOffset);
+}
+
+static void parseFogAnimation(StageParser *parser, Fog *fog, uint32_t fogAnimOffset) {
+	if (fogAnimOffset == 0) return;
+	StageCursor input = cursorAt(parser->stage, fogAnimOffset);
+	if (!cursorInRange(input)) return;
+
+	fog->animationPresent = 1;
+	//                                                                 Offset   Size   Description
+	parseKeyframes(parser, &fog->animation[TRACK_FOG_START], readItem(&input)); // 0x0      0x8    Start Distance Anim Data (Number, offset)
+	parseKeyframes(parser, &fog->animation[TRACK_FOG_END], readItem(&input));   // 0x8      0x8    End Distance Anim Data (Number, offset)
+	parseKeyframes(parser, &fog->animation[TRACK_FOG_RED], readItem(&input));   // 0x10     0x8    Red Anim Data (Number, offset)
+	parseKeyframes(parser, &fog->animation[TRACK_FOG_GREEN], readItem(&input)); // 0x18     0x8    Green Anim Data (Number, offset)
+	parseKeyframes(parser, &fog->animation[TRACK_FOG_BLUE], readItem(&input));  // 0x20     0x8    Blue Anim Data (Number, offset)
+	                                                                            // 0x28     0x8    Unknown Anim Data (Number, offset)
+}
+
+static void parseFieldAnimation(StageParser *parser, TransformAnimation *animation, uint32_t animHeaderOffset) {
+	if (animHeaderOffset == 0) return;
+	StageCursor input = cursorAt(parser->stage, animHeaderOffset);
+	if (!cursorInRange(input)) return;
+
+	KeyframeTrack *tracks = animation->tracks;
+	animation->present = 1;
+	//                                                                 Offset   Size   Description
+	parseKeyframes(parser, &tracks[TRACK_ROT_X], readItem(&input)); // 0x0      0x8    Rotation X Anim Data (Number, offset)
+	parseKeyframes(parser, &tracks[TRACK_ROT_Y], readItem(&input)); // 0x8      0x8    Rotation Y Anim Data (Number, offset)
+	parseKeyframes(parser, &tracks[TRACK_ROT_Z], readItem(&input)); // 0x10     0x8    Rotation Z Anim Data (Number, offset)
+	parseKeyframes(parser, &tracks[TRACK_POS_X], readItem(&input)); // 0x18     0x8    Translation X Anim Data (Number, offset)
+	parseKeyframes(parser, &tracks[TRACK_POS_Y], readItem(&input)); // 0x20     0x8    Translation Y Anim Data (Number, offset)
+	parseKeyframes(parser, &tracks[TRACK_POS_Z], readItem(&input)); // 0x28     0x8    Translation Z Anim Data (Number, offset)
+}
+
+// Tracks are shared between everything that points at them, the writers never change them
+static void parseKeyframes(StageParser *parser, KeyframeTrack *track, ConfigObject animData) {
+	if (findTrack(parser->tracks, animData, track)) return;
+	track->keyframes = readItems(parser, animData, &keyframeLayout, &track->count);
+	if (track->keyframes != NULL) {
+		addTrack(parser->tracks, animData, track);
+	}
+}
+
+static void parseReflectiveModels(StageParser *parser, CollisionField *field, ConfigObject item) {
+	if (item.number == 0 || item.offset == 0) return;
+	StageCursor input = cursorAt(parser->stage, item.offset);
+	uint32_t count = itemsInStage(input, item.number, REFLECTIVE_MODEL_SIZE);
+	field->reflectiveModels = parserAlloc(parser, count, sizeof(const char *));
+	if (field->reflectiveModels == NULL) return;
+	field->reflectiveModelCount = count;
+
+	for (uint32_t i = 0; i < count; i++) {
+		//                                                                 Offset   Size   Description
+		uint32_t nameOffset = readInt(&input);                          // 0x0      0x4    Name offset
+		field->reflectiveModels[i] = readAsciiName(parser, nameOffset);
+		cursorSkip(&input, 0x4);                                            // 0x4      0x4    Null
+	}
+}
+
+static void parseLevelModelBs(StageParser *parser, CollisionField *field, ConfigObject item) {
+	if (item.number == 0 || item.offset == 0) return;
+	StageCursor input = cursorAt(parser->stage, item.offset);
+	uint32_t count = itemsInStage(input, item.number, LEVEL_MODEL_B_STEP);
+	field->levelModels = parserAlloc(parser, count, sizeof(const char *));
+	if (field->levelModels == NULL) return;
+	field->levelModelCount = count;
+
+	for (uint32_t i = 0; i < count; i++) {
+		//                                                                 Offset   Size   Description
+		                                                                 // Level Model B
+		uint32_t levelModelAPointerOffset = readInt(&input);            // 0x0      0x4    Offset to the Level Model A Pointer
+		StageCursor levelModelAPointer = cursorAt(parser->stage, levelModelAPointerOffset);
+		                                                                // Level Model A Pointer
+		cursorSkip(&levelModelAPointer, 0x8);                           // 0x0      0x8    0x0000000000000001
+		uint32_t levelModelAOffset = readInt(&levelModelAPointer);      // 0x8      0x4    Offset to Level Model A
+		StageCursor levelModelA = cursorAt(parser->stage, levelModelAOffset);
+		                                                                 // Level Model A
+		cursorSkip(&levelModelA, 0x4);                                  // 0x0      0x4    Null
+		uint32_t levelModelNameOffset = readInt(&levelModelA);
+		field->levelModels[i] = readAsciiName(parser, levelModelNameOffset);
+	}
+}
+
+static void parseWormholes(StageParser *parser, CollisionField *field, ConfigObject item) {
+	if (item.number == 0 || item.offset == 0) return;
+	StageCursor input = cursorAt(parser->stage, item.offset);
+	uint32_t count = itemsInStage(input, item.number, WORMHOLE_SIZE);
+	field->wormholes = parserAlloc(parser, count, sizeof(Wormhole));
+	if (field->wormholes == NULL) return;
+	field->wormholeCount = count;
+
+	for (uint32_t i = 0; i < count; i++) {
+		Wormhole *wormhole = &field->wormholes[i];
+		wormhole->offset = (uint32_t)cursorTell(&input);
+		//                                                                 Offset   Size   Description
+		cursorSkip(&input, 0x4);                                            // 0x0      0x4    0x00000001
+		wormhole->position = readVectorF32(&input);                     // 0x4      0xC    Position (X, Y, Z)
+		VectorI16 rotOriginal = readVectorI16(&input, 1);               // 0x10     0x8    Rotation (X, Y, Z, Padd)
+		wormhole->rotation = convertRot16ToF32(rotOriginal);
+		wormhole->destinationOffset = readInt(&input);                  // 0x18     0x4    Offset to destination wormhole
+	}
+}
+
+static ConfigObject readItem(StageCursor *input) {
+	ConfigObject configObject;
+	configObject.number = readInt(input);
+	configObject.offset = readInt(input);
+	return configObject;
+}
+
+static VectorF32 readVectorF32(StageCursor *input) {
+	VectorF32 vector32;
+	vector32.x = readFloat(input);
+	vector32.y = readFloat(input);
+	vector32.z = readFloat(input);
+	return vector32;
+}
+
+static VectorI16 readVectorI16(StageCursor *input, int eatPadding) {
+	VectorI16 vector16;
+	vector16.x = readShort(input);
+	vector16.y = readShort(input);
+	vector16.z = readShort(input);
+	if (eatPadding) readShort(input);
+	return vector16;
+}
+
+// Decodes a whole item array into the model, items that run off the end of the stage read as zero like the cursor does
+static void *readItems(StageParser *parser, ConfigObject item, const ItemLayout *layout, uint32_t *count) {
+	*count = 0;
+	if (item.number == 0 || item.offset == 0) return NULL;
+	StageCursor input = cursorAt(parser->stage, item.offset);
+
+	// Only the items that start inside the stage need decoding
+	uint32_t itemCount = itemsInStage(input, item.number, layout->stride);
+	void *items = parserAlloc(parser, itemCount, layout->itemSize);
+	if (items == NULL) return NULL;
+	if (decodeItems(parser, input, itemCount, layout, items) != 0) return NULL;
+	*count = itemCount;
+	return items;
+}
+
+// Decodes itemCount items at input, the last one can run off the end of the stage and reads as zeros past it
+static int decodeItems(StageParser *parser, StageCursor input, uint32_t itemCount, const ItemLayout *layout, void *items) {
+	uint32_t size = itemCount * layout->stride;
+	uint32_t resident = stageResidentSpan(input.stage, input.offset, size);
+
+	// The last item can run off the end of the stage
+	const uint8_t *data = input.base + input.offset;
+	uint8_t *padded = NULL;
+	if (resident < size) {
+		padded = calloc(size, 1);
+		if (padded == NULL) {
+			parser->error = 1;
+			return -1;
+		}
+		memcpy(padded, data, resident);
+		data = padded;
+	}
+	int result = decodeItemLayout(items, data, itemCount, layout, STAGE_BIG_ENDIAN);
+	free(padded);
+	if (result != 0) {
+		parser->error = 1;
+		return -1;
+	}
+	return 0;
+}
+
+static void parseCollisionMesh(StageParser *parser, CollisionMesh *mesh, CollisionGroupHeader grid) {
+	if (grid.triangleListOffset == 0 || grid.gridTriangleListOffet == 0) return;
+
+	// The triangles aren't counted anywhere, there are as many as the highest index any grid cell lists
+	StageCursor cells = cursorAt(parser->stage, grid.gridTriangleListOffet);
+	uint64_t cellCount = (uint64_t)grid.gridStepXCount * grid.gridStepZCount;
+	cellCount = itemsInStage(cells, cellCount > UINT32_MAX ? UINT32_MAX : (uint32_t)cellCount, 0x4);
+	// A broken stage can point every cell at a list that never ends, so all the lists together
+	// get no more reads than the stage has room for indices
+	uint32_t budget = parser->stage.stage->size / 2;
+	uint32_t triangleCount = 0;
+	for (uint32_t i = 0; i < cellCount && budget > 0; i++) {
+		uint32_t listOffset = readInt(&cells);                          // 0x0      0x4    Offset to the cell's triangle list (0 if empty)
+		if (listOffset == 0) continue;
+		StageCursor list = cursorAt(parser->stage, listOffset);
+		while (cursorInRange(list) && budget > 0) {
+			uint16_t index = readShort(&list);                          // 0x0      0x2    Triangle index, 0xFFFF ends the list
+			budget--;
+			if (index == 0xFFFF) break;
+			if (index >= triangleCount) {
+				triangleCount = index + 1u;
+			}
+		}
+	}
+
+	StageCursor input = cursorAt(parser->stage, grid.triangleListOffset);
+	triangleCount = itemsInStage(input, triangleCount, COLLISION_TRIANGLE_SIZE);
+	if (triangleCount == 0) return;
+	VectorF32 *vertices = parserAlloc(parser, triangleCount * 3, sizeof(VectorF32));
+	VectorF32 *normals = parserAlloc(parser, triangleCount, sizeof(VectorF32));
+	if (vertices == NULL || normals == NULL) return;
+
+	// Decoded a whole list at a time like the other items, then turned into vertices
+	CollisionTriangle *triangles = malloc(triangleCount * sizeof(CollisionTriangle));
+	if (triangles == NULL) {
+		parser->error = 1;
+		return;
+	}
+	if (decodeItems(parser, input, triangleCount, &collisionTriangleLayout, triangles) == 0) {
+		mesh->triangleCount = triangleCount;
+		mesh->vertices = vertices;
+		mesh->normals = normals;
+		buildCollisionMesh(mesh, triangles);
+	}
+	free(triangles);
+}
+
+static CollisionGroupHeader readCollisionGroupHeader(StageCursor *input) {
+	CollisionGroupHeader colGroupHeader;
+	//                                                                 Offset   Size   Description
+	colGroupHeader.triangleListOffset = readInt(input);             // 0x0      0x4    Offset to the Collision Triangle List
+	colGroupHeader.gridTriangleListOffet = readInt(input);          // 0x4      0x4    Offset to the Grid Triangle List Pointers
+	colGroupHeader.gridStartX = readFloat(input);                   // 0x8      0x4    Grid Start X
+	colGroupHeader.gridStartZ = readFloat(input);                   // 0xC      0x4    Grid Start Z
+	colGroupHeader.gridStepX = readFloat(input);                    // 0x10     0x4    Grid Step X
+	colGroupHeader.gridStepZ = readFloat(input);                    // 0x14     0x4    Grid Step Z
+	colGroupHeader.gridStepXCount = readInt(input);                 // 0x18     0x4    Grid X Step Count
+	colGroupHeader.gridStepZCount = readInt(input);                 // 0x1C     0x4    Grid Z Steo Count
+	return colGroupHeader;
+}
+
+#undef parseStage
+#undef parseCollisionFields
+#undef parseCollisionFieldTask
+#undef parseCollisionField
+#undef parseFalloutPlane
+#undef parseBackgroundModels
+#undef parseBackgroundAnimationOne
+#undef parseFog
+#undef parseFogAnimation
+#undef parseFieldAnimation
+#undef parseKeyframes
+#undef parseReflectiveModels
+#undef parseLevelModelBs
+#undef parseWormholes
+#undef readItem
+#undef readVectorF32
+#undef readVectorI16
+#undef readCollisionGroupHeader
+#undef readItems
+#undef decodeItems
+#undef parseCollisionMesh
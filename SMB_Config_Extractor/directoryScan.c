@@ -0,0 +1,301 @@
+#include "directoryScan.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define PATH_SEPARATOR '\\'
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#define PATH_SEPARATOR '/'
+#endif
+
+typedef struct {
+	char *path;
+	int directory;
+}ScanItem;
+
+// The owner pushes and pops at the back so it goes depth first,
+// thieves take from the front where the oldest (usually biggest) directories are
+typedef struct {
+	ThreadLock *lock;
+	ScanItem *items;
+	uint32_t front;
+	uint32_t back;
+	uint32_t capacity;
+}ScanDeque;
+
+typedef struct {
+	ScanDeque *deques;
+	int workerCount;
+	ScanFileCallback onFile;
+	void *context;
+
+	ThreadLock *lock;               // Guards everything below
+	ThreadCondition *workAdded;
+	uint32_t pending;               // Items in a deque or being worked on, the scan is over once this is 0
+	uint32_t generation;            // Goes up with every push so idle workers know to look again
+	uint32_t failedDirectories;
+}DirectoryScan;
+
+static void visitDirectory(DirectoryScan *scan, int worker, const char *path);
+
+static char *joinPath(const char *directory, const char *name) {
+	size_t directoryLength = strlen(directory);
+	size_t nameLength = strlen(name);
+	char *path = malloc(directoryLength + nameLength + 2);
+	if (path == NULL) {
+		return NULL;
+	}
+	memcpy(path, directory, directoryLength);
+	if (directoryLength > 0 && directory[directoryLength - 1] != PATH_SEPARATOR && directory[directoryLength - 1] != '/') {
+		path[directoryLength++] = PATH_SEPARATOR;
+	}
+	memcpy(path + directoryLength, name, nameLength + 1);
+	return path;
+}
+
+// Takes ownership of path, returns -1 (leaving path alone) if there's no memory for it
+static int pushItem(DirectoryScan *scan, int worker, char *path, int directory) {
+	ScanDeque *deque = &scan->deques[worker];
+
+	// Counted before it can be stolen so pending can't reach 0 early
+	acquireThreadLock(scan->lock);
+	scan->pending++;
+	releaseThreadLock(scan->lock);
+
+	acquireThreadLock(deque->lock);
+	if (deque->back == deque->capacity && deque->front > 0) {
+		memmove(deque->items, deque->items + deque->front, (deque->back - deque->front) * sizeof(ScanItem));
+		deque->back -= deque->front;
+		deque->front = 0;
+	}
+	if (deque->back == deque->capacity) {
+		uint32_t capacity = deque->capacity < 16 ? 16 : deque->capacity * 2;
+		ScanItem *items = realloc(deque->items, capacity * sizeof(ScanItem));
+		if (items == NULL) {
+			releaseThreadLock(deque->lock);
+			acquireThreadLock(scan->lock);
+			scan->pending--;
+			releaseThreadLock(scan->lock);
+			return -1;
+		}
+		deque->items = items;
+		deque->capacity = capacity;
+	}
+	deque->items[deque->back].path = path;
+	deque->items[deque->back].directory = directory;
+	deque->back++;
+	releaseThreadLock(deque->lock);
+
+	acquireThreadLock(scan->lock);
+	scan->generation++;
+	wakeThreadCondition(scan->workAdded);
+	releaseThreadLock(scan->lock);
+	return 0;
+}
+
+static int popItem(ScanDeque *deque, ScanItem *item, int steal) {
+	int found = 0;
+	acquireThreadLock(deque->lock);
+	if (deque->back > deque->front) {
+		*item = steal ? deque->items[deque->front++] : deque->items[--deque->back];
+		if (deque->front == deque->back) {
+			deque->front = 0;
+			deque->back = 0;
+		}
+		found = 1;
+	}
+	releaseThreadLock(deque->lock);
+	return found;
+}
+
+static int takeItem(DirectoryScan *scan, int worker, ScanItem *item) {
+	if (popItem(&scan->deques[worker], item, 0)) {
+		return 1;
+	}
+	for (int i = 1; i < scan->workerCount; i++) {
+		if (popItem(&scan->deques[(worker + i) % scan->workerCount], item, 1)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Queues an entry of a directory, or deals with it straight away if it can't be queued
+static void foundEntry(DirectoryScan *scan, int worker, char *path, int directory) {
+	if (pushItem(scan, worker, path, directory) == 0) {
+		return;
+	}
+	if (directory) {
+		visitDirectory(scan, worker, path);
+	}
+	else {
+		scan->onFile(scan->context, path);
+	}
+	free(path);
+}
+
+static void directoryFailed(DirectoryScan *scan) {
+	acquireThreadLock(scan->lock);
+	scan->failedDirectories++;
+	releaseThreadLock(scan->lock);
+}
+
+static void visitDirectory(DirectoryScan *scan, int worker, const char *path) {
+#ifdef _WIN32
+	char *pattern = joinPath(path, "*");
+	if (pattern == NULL) {
+		directoryFailed(scan);
+		return;
+	}
+	WIN32_FIND_DATAA entry;
+	HANDLE find = FindFirstFileA(pattern, &entry);
+	free(pattern);
+	if (find == INVALID_HANDLE_VALUE) {
+		directoryFailed(scan);
+		return;
+	}
+	do {
+		if (strcmp(entry.cFileName, ".") == 0 || strcmp(entry.cFileName, "..") == 0) {
+			continue;
+		}
+		int directory = (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+		if (directory && (entry.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0) {
+			continue;
+		}
+		char *child = joinPath(path, entry.cFileName);
+		if (child != NULL) {
+			foundEntry(scan, worker, child, directory);
+		}
+	} while (FindNextFileA(find, &entry));
+	FindClose(find);
+#else
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		directoryFailed(scan);
+		return;
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+			continue;
+		}
+		char *child = joinPath(path, entry->d_name);
+		if (child == NULL) {
+			continue;
+		}
+		// Links are only followed to files
+		struct stat info;
+		int directory = 0;
+		int keep = 0;
+		if (lstat(child, &info) == 0) {
+			if (S_ISDIR(info.st_mode)) {
+				directory = 1;
+				keep = 1;
+			}
+			else if (S_ISREG(info.st_mode)) {
+				keep = 1;
+			}
+			else if (S_ISLNK(info.st_mode) && stat(child, &info) == 0 && S_ISREG(info.st_mode)) {
+				keep = 1;
+			}
+		}
+		if (keep) {
+			foundEntry(scan, worker, child, directory);
+		}
+		else {
+			free(child);
+		}
+	}
+	closedir(dir);
+#endif
+}
+
+static void scanWorker(void *context, uint32_t index) {
+	DirectoryScan *scan = context;
+	int worker = (int)index;
+	for (;;) {
+		acquireThreadLock(scan->lock);
+		uint32_t generation = scan->generation;
+		releaseThreadLock(scan->lock);
+
+		ScanItem item;
+		if (takeItem(scan, worker, &item)) {
+			if (item.directory) {
+				visitDirectory(scan, worker, item.path);
+			}
+			else {
+				scan->onFile(scan->context, item.path);
+			}
+			free(item.path);
+
+			acquireThreadLock(scan->lock);
+			if (--scan->pending == 0) {
+				wakeThreadCondition(scan->workAdded);
+			}
+			releaseThreadLock(scan->lock);
+			continue;
+		}
+
+		// Nothing to steal, wait for another worker to find something or for the scan to end
+		acquireThreadLock(scan->lock);
+		while (scan->pending > 0 && scan->generation == generation) {
+			waitThreadCondition(scan->workAdded, scan->lock);
+		}
+		int finished = scan->pending == 0;
+		releaseThreadLock(scan->lock);
+		if (finished) {
+			return;
+		}
+	}
+}
+
+int isDirectory(const char *path) {
+#ifdef _WIN32
+	DWORD attributes = GetFileAttributesA(path);
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+	struct stat info;
+	return stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+uint32_t scanDirectory(const char *path, ThreadPool *pool, int workerCount, ScanFileCallback onFile, void *context) {
+	DirectoryScan scan;
+	scan.workerCount = workerCount < 1 ? 1 : workerCount;
+	scan.onFile = onFile;
+	scan.context = context;
+	scan.pending = 0;
+	scan.generation = 0;
+	scan.failedDirectories = 0;
+	scan.lock = createThreadLock();
+	scan.workAdded = createThreadCondition();
+	scan.deques = calloc((size_t)scan.workerCount, sizeof(ScanDeque));
+	int ready = scan.lock != NULL && scan.workAdded != NULL && scan.deques != NULL;
+	for (int i = 0; ready && i < scan.workerCount; i++) {
+		scan.deques[i].lock = createThreadLock();
+		ready = scan.deques[i].lock != NULL;
+	}
+
+	char *root = ready ? joinPath(path, "") : NULL;
+	if (root != NULL && pushItem(&scan, 0, root, 1) == 0) {
+		runThreadPool(pool, (uint32_t)scan.workerCount, &scanWorker, &scan);
+	}
+	else {
+		free(root);
+		scan.failedDirectories = 1;
+	}
+
+	for (int i = 0; scan.deques != NULL && i < scan.workerCount; i++) {
+		destroyThreadLock(scan.deques[i].lock);
+		free(scan.deques[i].items);
+	}
+	free(scan.deques);
+	destroyThreadCondition(scan.workAdded);
+	destroyThreadLock(scan.lock);
+	return scan.failedDirectories;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+#include "threadPool.h"
+
+// Called on a worker thread for every file found, path is only valid until it returns
+typedef void (*ScanFileCallback)(void *context, const char *path);
+
+int isDirectory(const char *path);
+// Walks path and every directory under it with workerCount tasks on the pool
+// Each worker keeps a deque of directories and files it found and steals from the others once its own is empty,
+// files are handed to onFile as they're taken so listing directories overlaps with the work on the files
+// Symbolic links to directories aren't followed
+// Returns the number of directories that couldn't be read
+uint32_t scanDirectory(const char *path, ThreadPool *pool, int workerCount, ScanFileCallback onFile, void *context);
@@ -0,0 +1,333 @@
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "extractCache.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "FunctionsAndDefines.h"
+#include "threadPool.h"
+
+// Manifest layout (text, one field per space, paths run to the end of the line)
+// SMBCACHE <manifest version> <tool version>
+// <content hash> <flags> <output count> <input path>
+// <output size> <output path>     (output count times)
+#define MANIFEST_MAGIC "SMBCACHE"
+#define MANIFEST_VERSION 1
+#define MANIFEST_LINE_SIZE 1100
+
+typedef struct {
+	char *path;
+	uint64_t size;
+}CacheOutput;
+
+typedef struct {
+	char *input;
+	uint64_t hash;
+	uint32_t flags;
+	int outputCount;    // -1 once the entry has been dropped
+	CacheOutput outputs[CACHE_MAX_OUTPUTS];
+}CacheEntry;
+
+struct ExtractCache {
+	char *manifestName;
+	ThreadLock *lock;   // Files are extracted on several threads at once
+	CacheEntry *entries;
+	uint32_t entryCount;
+	uint32_t entryCapacity;
+	// Open addressed on the input path, each slot is an entry index + 1 or 0 if empty
+	uint32_t *slots;
+	uint32_t slotCount;
+	int changed;
+};
+
+static char *copyString(const char *string) {
+	size_t length = strlen(string);
+	char *copy = malloc(length + 1);
+	if (copy != NULL) {
+		memcpy(copy, string, length + 1);
+	}
+	return copy;
+}
+
+static uint32_t *findSlot(ExtractCache *cache, const char *input) {
+	uint32_t mask = cache->slotCount - 1;
+	uint32_t slot = (uint32_t)hashFNV1a((const uint8_t *)input, strlen(input)) & mask;
+	while (cache->slots[slot] != 0 && strcmp(cache->entries[cache->slots[slot] - 1].input, input) != 0) {
+		slot = (slot + 1) & mask;
+	}
+	return &cache->slots[slot];
+}
+
+// Keeps the slots at most half full
+static int growSlots(ExtractCache *cache) {
+	if ((cache->entryCount + 1) * 2 <= cache->slotCount) {
+		return 0;
+	}
+	uint32_t slotCount = cache->slotCount < 64 ? 64 : cache->slotCount * 2;
+	uint32_t *slots = calloc(slotCount, sizeof(uint32_t));
+	if (slots == NULL) {
+		return -1;
+	}
+	free(cache->slots);
+	cache->slots = slots;
+	cache->slotCount = slotCount;
+	for (uint32_t i = 0; i < cache->entryCount; i++) {
+		*findSlot(cache, cache->entries[i].input) = i + 1;
+	}
+	return 0;
+}
+
+static void freeOutputs(CacheEntry *entry) {
+	for (int i = 0; i < entry->outputCount; i++) {
+		free(entry->outputs[i].path);
+	}
+	entry->outputCount = -1;
+}
+
+// Returns the entry for input, adding an empty one if there isn't one yet
+static CacheEntry *getEntry(ExtractCache *cache, const char *input) {
+	if (cache->slotCount > 0) {
+		uint32_t *slot = findSlot(cache, input);
+		if (*slot != 0) {
+			return &cache->entries[*slot - 1];
+		}
+	}
+	if (growSlots(cache) != 0) {
+		return NULL;
+	}
+	if (cache->entryCount == cache->entryCapacity) {
+		uint32_t capacity = cache->entryCapacity < 64 ? 64 : cache->entryCapacity * 2;
+		CacheEntry *entries = realloc(cache->entries, capacity * sizeof(CacheEntry));
+		if (entries == NULL) {
+			return NULL;
+		}
+		cache->entries = entries;
+		cache->entryCapacity = capacity;
+	}
+	CacheEntry *entry = &cache->entries[cache->entryCount];
+	entry->input = copyString(input);
+	if (entry->input == NULL) {
+		return NULL;
+	}
+	entry->hash = 0;
+	entry->flags = 0;
+	entry->outputCount = -1;
+	*findSlot(cache, input) = ++cache->entryCount;
+	return entry;
+}
+
+static int fileSize(const char *path, uint64_t *size) {
+	struct stat info;
+	if (stat(path, &info) != 0) {
+		return -1;
+	}
+	*size = (uint64_t)info.st_size;
+	return 0;
+}
+
+// Reads a line without its line ending, returns -1 at the end of the file or if it's too long
+static int readLine(FILE *input, char *line) {
+	if (fgets(line, MANIFEST_LINE_SIZE, input) == NULL) {
+		return -1;
+	}
+	size_t length = strlen(line);
+	if (length == 0 || line[length - 1] != '\n') {
+		return -1;
+	}
+	line[--length] = '\0';
+	if (length > 0 && line[length - 1] == '\r') {
+		line[--length] = '\0';
+	}
+	return 0;
+}
+
+// The path starts after the given number of space separated fields
+static const char *pathAfterFields(const char *line, int fields) {
+	for (int i = 0; i < fields; i++) {
+		line = strchr(line, ' ');
+		if (line == NULL) {
+			return NULL;
+		}
+		line++;
+	}
+	return *line != '\0' ? line : NULL;
+}
+
+static void readManifest(ExtractCache *cache, FILE *input) {
+	char line[MANIFEST_LINE_SIZE];
+	unsigned int manifestVersion;
+	unsigned int toolVersion;
+	if (readLine(input, line) != 0 || sscanf(line, MANIFEST_MAGIC " %u %u", &manifestVersion, &toolVersion) != 2
+		|| manifestVersion != MANIFEST_VERSION || toolVersion != CACHE_TOOL_VERSION) {
+		return;
+	}
+
+	// A damaged entry ends the manifest, everything from there on is extracted again
+	while (readLine(input, line) == 0) {
+		uint64_t hash;
+		uint32_t flags;
+		int outputCount;
+		const char *inputPath = pathAfterFields(line, 3);
+		if (sscanf(line, "%" SCNx64 " %" SCNu32 " %d", &hash, &flags, &outputCount) != 3 || inputPath == NULL
+			|| outputCount < 0 || outputCount > CACHE_MAX_OUTPUTS) {
+			return;
+		}
+		CacheEntry *entry = getEntry(cache, inputPath);
+		if (entry == NULL) {
+			return;
+		}
+		freeOutputs(entry);
+		entry->hash = hash;
+		entry->flags = flags;
+		entry->outputCount = 0;
+		for (int i = 0; i < outputCount; i++) {
+			uint64_t size;
+			const char *outputPath;
+			if (readLine(input, line) != 0 || sscanf(line, "%" SCNu64, &size) != 1 || (outputPath = pathAfterFields(line, 1)) == NULL) {
+				freeOutputs(entry);
+				return;
+			}
+			entry->outputs[i].path = copyString(outputPath);
+			entry->outputs[i].size = size;
+			if (entry->outputs[i].path == NULL) {
+				freeOutputs(entry);
+				return;
+			}
+			entry->outputCount++;
+		}
+	}
+}
+
+ExtractCache *openExtractCache(const char *manifestName) {
+	ExtractCache *cache = calloc(1, sizeof(ExtractCache));
+	if (cache == NULL) {
+		return NULL;
+	}
+	cache->manifestName = copyString(manifestName);
+	cache->lock = createThreadLock();
+	if (cache->manifestName == NULL || cache->lock == NULL) {
+		free(cache->manifestName);
+		destroyThreadLock(cache->lock);
+		free(cache);
+		return NULL;
+	}
+
+	FILE *input = fopen(manifestName, "rb");
+	if (input != NULL) {
+		readManifest(cache, input);
+		fclose(input);
+	}
+	return cache;
+}
+
+static int writeManifest(const ExtractCache *cache) {
+	// Written next to the old one first so a failed write doesn't lose it
+	size_t nameLength = strlen(cache->manifestName);
+	char *temporaryName = malloc(nameLength + 5);
+	if (temporaryName == NULL) {
+		return -1;
+	}
+	memcpy(temporaryName, cache->manifestName, nameLength);
+	memcpy(temporaryName + nameLength, ".tmp", 5);
+
+	FILE *output = fopen(temporaryName, "wb");
+	if (output == NULL) {
+		free(temporaryName);
+		return -1;
+	}
+	int result = fprintf(output, MANIFEST_MAGIC " %d %d\n", MANIFEST_VERSION, CACHE_TOOL_VERSION) > 0 ? 0 : -1;
+	for (uint32_t i = 0; i < cache->entryCount && result == 0; i++) {
+		const CacheEntry *entry = &cache->entries[i];
+		if (entry->outputCount < 0) {
+			continue;
+		}
+		if (fprintf(output, "%016" PRIx64 " %" PRIu32 " %d %s\n", entry->hash, entry->flags, entry->outputCount, entry->input) < 0) {
+			result = -1;
+		}
+		for (int j = 0; j < entry->outputCount && result == 0; j++) {
+			if (fprintf(output, "%" PRIu64 " %s\n", entry->outputs[j].size, entry->outputs[j].path) < 0) {
+				result = -1;
+			}
+		}
+	}
+	if (fclose(output) != 0) {
+		result = -1;
+	}
+
+	if (result == 0) {
+		// rename doesn't replace an existing file on Windows
+		remove(cache->manifestName);
+		result = rename(temporaryName, cache->manifestName) == 0 ? 0 : -1;
+	}
+	if (result != 0) {
+		remove(temporaryName);
+	}
+	free(temporaryName);
+	return result;
+}
+
+int closeExtractCache(ExtractCache *cache) {
+	if (cache == NULL) {
+		return 0;
+	}
+	int result = cache->changed ? writeManifest(cache) : 0;
+	for (uint32_t i = 0; i < cache->entryCount; i++) {
+		freeOutputs(&cache->entries[i]);
+		free(cache->entries[i].input);
+	}
+	free(cache->entries);
+	free(cache->slots);
+	free(cache->manifestName);
+	destroyThreadLock(cache->lock);
+	free(cache);
+	return result;
+}
+
+int isExtractionCached(ExtractCache *cache, const char *input, uint64_t hash, uint32_t flags) {
+	acquireThreadLock(cache->lock);
+	int cached = 0;
+	uint32_t *slot = cache->slotCount > 0 ? findSlot(cache, input) : NULL;
+	if (slot != NULL && *slot != 0) {
+		const CacheEntry *entry = &cache->entries[*slot - 1];
+		cached = entry->outputCount > 0 && entry->hash == hash && entry->flags == flags;
+		for (int i = 0; cached && i < entry->outputCount; i++) {
+			uint64_t size;
+			cached = fileSize(entry->outputs[i].path, &size) == 0 && size == entry->outputs[i].size;
+		}
+	}
+	releaseThreadLock(cache->lock);
+	return cached;
+}
+
+void recordExtraction(ExtractCache *cache, const char *input, uint64_t hash, uint32_t flags, const char *const outputs[], int outputCount) {
+	acquireThreadLock(cache->lock);
+	CacheEntry *entry = getEntry(cache, input);
+	if (entry != NULL) {
+		freeOutputs(entry);
+		entry->hash = hash;
+		entry->flags = flags;
+		entry->outputCount = 0;
+		// Paths with line breaks can't be written to the manifest
+		int usable = outputCount <= CACHE_MAX_OUTPUTS && strchr(input, '\n') == NULL;
+		for (int i = 0; usable && i < outputCount; i++) {
+			CacheOutput *output = &entry->outputs[i];
+			usable = strchr(outputs[i], '\n') == NULL && fileSize(outputs[i], &output->size) == 0
+				&& (output->path = copyString(outputs[i])) != NULL;
+			if (usable) {
+				entry->outputCount++;
+			}
+		}
+		if (!usable) {
+			freeOutputs(entry);
+		}
+		cache->changed = 1;
+	}
+	releaseThreadLock(cache->lock);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+// A manifest of which outputs were made from which input, so inputs that haven't changed can be skipped
+// Entries are keyed by the input path and only match the same content hash, flags and tool version
+typedef struct ExtractCache ExtractCache;
+
+// Bump whenever extraction output changes so every old entry is ignored
+#define CACHE_TOOL_VERSION 1
+#define CACHE_MAX_OUTPUTS 4
+
+// Loads the manifest, one that's missing or from another tool version starts off empty
+// Returns NULL only if out of memory
+ExtractCache *openExtractCache(const char *manifestName);
+// Writes the manifest back if anything changed, then frees the cache
+// Returns -1 if the manifest couldn't be written
+int closeExtractCache(ExtractCache *cache);
+// Returns 1 if input was extracted from the same bytes with the same flags and every output is still there unchanged in size
+int isExtractionCached(ExtractCache *cache, const char *input, uint64_t hash, uint32_t flags);
+// Remembers the outputs made from input, they have to exist already
+void recordExtraction(ExtractCache *cache, const char *input, uint64_t hash, uint32_t flags, const char *const outputs[], int outputCount);
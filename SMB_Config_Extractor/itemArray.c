@@ -0,0 +1,215 @@
+#include "itemArray.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Define ITEM_NO_SIMD to only build the scalar code, the rotation test checks the vector paths against it
+#if defined(ITEM_NO_SIMD)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define ITEM_USE_AVX2
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define ITEM_USE_SSSE3
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ITEM_USE_SSE2
+#endif
+
+// Items are swapped this many at a time so the words are still in cache when they're gathered
+#define ITEM_BLOCK_SIZE 64
+
+void decodeWords(uint32_t *output, const uint8_t *input, uint32_t count, int bigEndian) {
+	uint32_t i = 0;
+	if (bigEndian) {
+		// The vector paths only exist on x86, which is always little endian
+#if defined(ITEM_USE_AVX2)
+		const __m256i swapMask = _mm256_setr_epi8(
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+		for (; i + 8 <= count; i += 8) {
+			__m256i words = _mm256_loadu_si256((const __m256i *)(input + i * 4));
+			_mm256_storeu_si256((__m256i *)(output + i), _mm256_shuffle_epi8(words, swapMask));
+		}
+#elif defined(ITEM_USE_SSSE3)
+		const __m128i swapMask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+		for (; i + 4 <= count; i += 4) {
+			__m128i words = _mm_loadu_si128((const __m128i *)(input + i * 4));
+			_mm_storeu_si128((__m128i *)(output + i), _mm_shuffle_epi8(words, swapMask));
+		}
+#elif defined(ITEM_USE_SSE2)
+		for (; i + 4 <= count; i += 4) {
+			__m128i words = _mm_loadu_si128((const __m128i *)(input + i * 4));
+			// Swap the bytes of each short, then the shorts of each word
+			words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+			words = _mm_shufflelo_epi16(words, _MM_SHUFFLE(2, 3, 0, 1));
+			words = _mm_shufflehi_epi16(words, _MM_SHUFFLE(2, 3, 0, 1));
+			_mm_storeu_si128((__m128i *)(output + i), words);
+		}
+#endif
+		for (; i < count; ++i) {
+			const uint8_t *data = input + i * 4;
+			output[i] = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+		}
+	}
+	else {
+		for (; i < count; ++i) {
+			const uint8_t *data = input + i * 4;
+			output[i] = (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+		}
+	}
+}
+
+int decodeItemArray(ItemArray *array, const uint8_t *data, uint32_t count, uint32_t stride,
+	const uint16_t *fields, uint32_t fieldCount, int bigEndian) {
+	array->count = 0;
+	array->fieldCount = fieldCount;
+	array->columns = NULL;
+	if (fieldCount > ITEM_MAX_FIELDS || stride == 0) {
+		return -1;
+	}
+	for (uint32_t field = 0; field < fieldCount; ++field) {
+		uint32_t offset = fields[field] & ~ITEM_FIELD_SHORT;
+		uint32_t size = (fields[field] & ITEM_FIELD_SHORT) ? 2 : 4;
+		if (offset % size != 0 || offset + size > stride) {
+			return -1;
+		}
+	}
+	if (count == 0) {
+		return 0;
+	}
+	if ((size_t)count > SIZE_MAX / sizeof(uint32_t) / (fieldCount > 0 ? fieldCount : 1)) {
+		return -1;
+	}
+
+	// Items that aren't a whole number of words are copied out and padded first
+	uint32_t wordStride = (stride + 3) / 4;
+	int padItems = stride % 4 != 0;
+	uint32_t *columns = malloc((size_t)count * fieldCount * sizeof(uint32_t) + 1);
+	uint32_t *words = malloc((size_t)ITEM_BLOCK_SIZE * wordStride * 4);
+	uint8_t *padded = padItems ? calloc(ITEM_BLOCK_SIZE, (size_t)wordStride * 4) : NULL;
+	if (columns == NULL || words == NULL || (padItems && padded == NULL)) {
+		free(columns);
+		free(words);
+		free(padded);
+		return -1;
+	}
+
+	for (uint32_t first = 0; first < count; first += ITEM_BLOCK_SIZE) {
+		uint32_t blockCount = count - first < ITEM_BLOCK_SIZE ? count - first : ITEM_BLOCK_SIZE;
+		const uint8_t *block = data + (size_t)first * stride;
+		if (padItems) {
+			for (uint32_t i = 0; i < blockCount; ++i) {
+				memcpy(padded + (size_t)i * wordStride * 4, block + (size_t)i * stride, stride);
+			}
+			block = padded;
+		}
+		decodeWords(words, block, blockCount * wordStride, bigEndian);
+
+		for (uint32_t field = 0; field < fieldCount; ++field) {
+			uint32_t offset = fields[field] & ~ITEM_FIELD_SHORT;
+			const uint32_t *word = words + offset / 4;
+			uint32_t *column = columns + (size_t)field * count + first;
+			if (fields[field] & ITEM_FIELD_SHORT) {
+				// The first short of a word is its high half in big endian and its low half in little endian
+				uint32_t shift = ((offset & 2) == 0) == (bigEndian != 0) ? 16 : 0;
+				for (uint32_t i = 0; i < blockCount; ++i) {
+					column[i] = (word[i * wordStride] >> shift) & 0xFFFF;
+				}
+			}
+			else {
+				for (uint32_t i = 0; i < blockCount; ++i) {
+					column[i] = word[i * wordStride];
+				}
+			}
+		}
+	}
+
+	free(words);
+	free(padded);
+	array->count = count;
+	array->columns = columns;
+	return 0;
+}
+
+void convertItemRotations(ItemArray *array, uint32_t field, uint32_t fieldCount) {
+	if (field + fieldCount > array->fieldCount) {
+		return;
+	}
+	// Columns are stored back to back, so the fields are one run of values
+	uint32_t *words = array->columns + (size_t)field * array->count;
+	uint32_t count = fieldCount * array->count;
+	uint32_t i = 0;
+
+	// The values are widened shorts, so converting them as signed ints is still exact
+#if defined(ITEM_USE_AVX2)
+	const __m256 scale = _mm256_set1_ps(ROTATION_TO_DEGREES);
+	for (; i + 8 <= count; i += 8) {
+		__m256 degrees = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(words + i))), scale);
+		_mm256_storeu_si256((__m256i *)(words + i), _mm256_castps_si256(degrees));
+	}
+#elif defined(ITEM_USE_SSSE3) || defined(ITEM_USE_SSE2)
+	const __m128 scale = _mm_set1_ps(ROTATION_TO_DEGREES);
+	for (; i + 4 <= count; i += 4) {
+		__m128 degrees = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(words + i))), scale);
+		_mm_storeu_si128((__m128i *)(words + i), _mm_castps_si128(degrees));
+	}
+#endif
+	for (; i < count; ++i) {
+		float degrees = convertRotation((uint16_t)words[i]);
+		memcpy(&words[i], &degrees, sizeof(degrees));
+	}
+}
+
+int decodeItemLayout(void *items, const uint8_t *data, uint32_t count, const ItemLayout *layout, int bigEndian) {
+	uint16_t fields[ITEM_MAX_FIELDS];
+	if (layout->fieldCount > ITEM_MAX_FIELDS) {
+		return -1;
+	}
+	for (uint32_t field = 0; field < layout->fieldCount; ++field) {
+		const ItemField *itemField = &layout->fields[field];
+		uint32_t size = itemField->type == ITEM_U16 ? 2 : 4;
+		// Rotations are only ever stored as shorts
+		if (itemField->target + size > layout->itemSize
+			|| (itemField->type == ITEM_ROTATION && !(itemField->source & ITEM_FIELD_SHORT))) {
+			return -1;
+		}
+		fields[field] = itemField->source;
+	}
+
+	ItemArray array;
+	if (decodeItemArray(&array, data, count, layout->stride, fields, layout->fieldCount, bigEndian) != 0) {
+		return -1;
+	}
+
+	// Scatter one column at a time into the output items
+	uint8_t *output = items;
+	for (uint32_t field = 0; field < layout->fieldCount; ++field) {
+		const ItemField *itemField = &layout->fields[field];
+		if (itemField->type == ITEM_ROTATION) {
+			convertItemRotations(&array, field, 1);
+		}
+		const uint32_t *column = array.columns + (size_t)field * array.count;
+		uint8_t *target = output + itemField->target;
+		if (itemField->type == ITEM_U16) {
+			for (uint32_t i = 0; i < array.count; ++i) {
+				uint16_t value = (uint16_t)column[i];
+				memcpy(target + (size_t)i * layout->itemSize, &value, sizeof(value));
+			}
+		}
+		else {
+			for (uint32_t i = 0; i < array.count; ++i) {
+				memcpy(target + (size_t)i * layout->itemSize, &column[i], sizeof(uint32_t));
+			}
+		}
+	}
+
+	freeItemArray(&array);
+	return 0;
+}
+
+void freeItemArray(ItemArray *array) {
+	free(array->columns);
+	array->columns = NULL;
+	array->count = 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// Fields are given by their byte offset in the item, 2 byte fields are marked with ITEM_SHORT
+#define ITEM_FIELD_SHORT 0x8000
+#define ITEM_SHORT(offset) ((offset) | ITEM_FIELD_SHORT)
+#define ITEM_MAX_FIELDS 16
+
+// A fixed stride array of items decoded in one pass, one column of host order values per field
+// Short fields are widened to 32 bits
+typedef struct {
+	uint32_t count;       // Items that were decoded, anything past this reads as zero
+	uint32_t fieldCount;
+	uint32_t *columns;    // fieldCount columns of count values
+}ItemArray;
+
+// Rotations are stored as 16 bit fractions of a full turn
+// rotation * 360 / 65536 never needs more than 22 significant bits, so it's exact as a float
+#define ROTATION_TO_DEGREES (360.0f / 65536.0f)
+
+static inline float convertRotation(uint16_t rotation) {
+	return (float)rotation * ROTATION_TO_DEGREES;
+}
+
+// Swaps count 32 bit words from a stage of the given byte order into host order
+void decodeWords(uint32_t *output, const uint8_t *input, uint32_t count, int bigEndian);
+
+// Decodes count items of stride bytes from data
+// Returns 0 on success, -1 if there are too many fields or the columns couldn't be allocated
+int decodeItemArray(ItemArray *array, const uint8_t *data, uint32_t count, uint32_t stride,
+	const uint16_t *fields, uint32_t fieldCount, int bigEndian);
+void freeItemArray(ItemArray *array);
+// Converts fieldCount short fields starting at field from rotations to degrees in place, read them back with itemF32
+void convertItemRotations(ItemArray *array, uint32_t field, uint32_t fieldCount);
+
+// What a decoded field is stored as in the output items
+enum ITEM_FIELD_TYPE {
+	ITEM_U32,
+	ITEM_U16,
+	ITEM_F32,
+	ITEM_ROTATION,    // 2 byte rotation, stored as a float in degrees
+};
+
+typedef struct {
+	uint16_t source;  // Offset in the stage item, ITEM_SHORT for 2 byte fields
+	uint16_t type;    // ITEM_FIELD_TYPE
+	uint32_t target;  // Offset in the output item
+}ItemField;
+
+// Describes one kind of item, how it's laid out in the stage and where its fields go in the output struct
+typedef struct {
+	uint32_t stride;
+	uint32_t itemSize;
+	uint32_t fieldCount;
+	ItemField fields[ITEM_MAX_FIELDS];
+}ItemLayout;
+
+// Decodes count items into an array of layout->itemSize byte structs, bytes not covered by a field are left alone
+// Returns 0 on success, -1 if the layout is bad or memory ran out
+int decodeItemLayout(void *items, const uint8_t *data, uint32_t count, const ItemLayout *layout, int bigEndian);
+
+static inline uint32_t itemU32(const ItemArray *array, uint32_t field, uint32_t index) {
+	if (index >= array->count) {
+		return 0;
+	}
+	return array->columns[field * array->count + index];
+}
+
+static inline uint16_t itemU16(const ItemArray *array, uint32_t field, uint32_t index) {
+	return (uint16_t)itemU32(array, field, index);
+}
+
+static inline float itemF32(const ItemArray *array, uint32_t field, uint32_t index) {
+	uint32_t toCast = itemU32(array, field, index);
+	float floatValue;
+	memcpy(&floatValue, &toCast, sizeof(floatValue));
+	return floatValue;
+}
@@ -0,0 +1,620 @@
+// The smbcnv style config extractor, compiled once per byte order by main.c
+// The includer defines ENDIAN_SUFFIX, STAGE_BIG_ENDIAN and readInt, readShort, readFloat and readRot for that byte order
+
+// Reads item index's rotation triple, from rotations if it was decoded there and from the stage otherwise
+// Either way the stage ends up just past the triple
+static void ENDIAN_NAME(readLegacyRotation)(StageFile *lz, const ItemArray *rotations, int index, float *xRot, float *yRot, float *zRot) {
+	if ((uint32_t)index < rotations->count) {
+		*xRot = itemF32(rotations, 0, (uint32_t)index);
+		*yRot = itemF32(rotations, 1, (uint32_t)index);
+		*zRot = itemF32(rotations, 2, (uint32_t)index);
+		stageSeek(lz, 6, SEEK_CUR);
+		return;
+	}
+	*xRot = readRot(lz);
+	*yRot = readRot(lz);
+	*zRot = readRot(lz);
+}
+
+static int ENDIAN_NAME(extractConfigOld)(StageFile *lz, const char* filename, int game, NameTable *names) {
+	ConfigObjectOld collisionFields = { 0, 0 };   // Only SMB1 has these in the header
+	ConfigObjectOld startPositions;
+	ConfigObjectOld falloutY;
+	ConfigObjectOld goals;
+	ConfigObjectOld bumpers;
+	ConfigObjectOld jamabars;
+	ConfigObjectOld bananas;
+	ConfigObjectOld backgrounds;
+	ItemArray rotations;
+
+	stageSeek(lz, 8, SEEK_SET);
+
+	if (game == SMB1) {
+		collisionFields.number = readInt(lz);
+		collisionFields.offset = readInt(lz);
+	}
+	else {
+		stageSeek(lz, 8, SEEK_CUR);
+	}
+	startPositions.offset = readInt(lz);
+
+	falloutY.number = 1;
+	falloutY.offset = readInt(lz);
+
+	startPositions.number = (falloutY.offset - startPositions.offset) / 0x14;
+
+	goals.number = readInt(lz);
+	goals.offset = readInt(lz);
+
+	if (game == SMB1) {
+		stageSeek(lz, 8, SEEK_CUR);
+	}
+
+	bumpers.number = readInt(lz);
+	bumpers.offset = readInt(lz);
+
+	jamabars.number = readInt(lz);
+	jamabars.offset = readInt(lz);
+
+	bananas.number = readInt(lz);
+	bananas.offset = readInt(lz);
+
+	if (game == SMB1) {
+		stageSeek(lz, 104, SEEK_SET);
+	}
+	else {
+		stageSeek(lz, 88, SEEK_SET);
+	}
+
+	backgrounds.number = readInt(lz);
+	backgrounds.offset = readInt(lz);
+
+	char outfileName[OUTPUT_NAME_SIZE];
+	if (makeOutputName(outfileName, sizeof(outfileName), filename, ".txt") != 0) {
+		return -1;
+	}
+	FILE* outfile = fopen(outfileName, "w");
+	if (outfile == NULL) {
+		return -1;
+	}
+
+	stageSeek(lz, falloutY.offset, SEEK_SET);
+
+	float falloutYYPos = readFloat(lz);
+	fprintf(outfile, "fallout [ 0 ] . pos . y = %f\n", falloutYYPos);
+
+	fprintf(outfile, "\n");
+
+	decodeLegacyRotations(lz, startPositions, 0x14, STAGE_BIG_ENDIAN, &rotations);
+	stageSeek(lz, startPositions.offset, SEEK_SET);
+
+	for (int j = 0; j < startPositions.number; ++j) {
+		float xPos = readFloat(lz);
+		float yPos = readFloat(lz);
+		float zPos = readFloat(lz);
+
+		float xRot, yRot, zRot;
+		ENDIAN_NAME(readLegacyRotation)(lz, &rotations, j, &xRot, &yRot, &zRot);
+
+		stageSeek(lz, 2, SEEK_CUR);
+
+		fprintf(outfile, "start [ %d ] . pos . x = %f\n", j, xPos);
+		fprintf(outfile, "start [ %d ] . pos . y = %f\n", j, yPos);
+		fprintf(outfile, "start [ %d ] . pos . z = %f\n", j, zPos);
+
+		fprintf(outfile, "start [ %d ] . rot . x = %f\n", j, xRot);
+		fprintf(outfile, "start [ %d ] . rot . y = %f\n", j, yRot);
+		fprintf(outfile, "start [ %d ] . rot . z = %f\n", j, zRot);
+
+		fprintf(outfile, "\n");
+	}
+	freeItemArray(&rotations);
+
+	decodeLegacyRotations(lz, goals, 0x14, STAGE_BIG_ENDIAN, &rotations);
+	stageSeek(lz, goals.offset, SEEK_SET);
+
+	for (int j = 0; j < goals.number; ++j) {
+		float xPos = readFloat(lz);
+		float yPos = readFloat(lz);
+		float zPos = readFloat(lz);
+
+		float xRot, yRot, zRot;
+		ENDIAN_NAME(readLegacyRotation)(lz, &rotations, j, &xRot, &yRot, &zRot);
+
+		uint16_t shortType = readShort(lz);
+		char type = 'B';
+		if (game == SMB1) {
+			if (shortType == 0x4200) {
+				type = 'B';
+			}
+			else if (shortType == 0x4700) {
+				type = 'G';
+			}
+			else if (shortType == 0x5200) {
+				type = 'R';
+			}
+		}
+		else {
+			if (shortType == 0x0001) {
+				type = 'B';
+			}
+			else if (shortType == 0x0101) {
+				type = 'G';
+			}
+			else if (shortType == 0x0201) {
+				type = 'R';
+			}
+		}
+
+		fprintf(outfile, "goal [ %d ] . pos . x = %f\n", j, xPos);
+		fprintf(outfile, "goal [ %d ] . pos . y = %f\n", j, yPos);
+		fprintf(outfile, "goal [ %d ] . pos . z = %f\n", j, zPos);
+
+		fprintf(outfile, "goal [ %d ] . rot . x = %f\n", j, xRot);
+		fprintf(outfile, "goal [ %d ] . rot . y = %f\n", j, yRot);
+		fprintf(outfile, "goal [ %d ] . rot . z = %f\n", j, zRot);
+
+		fprintf(outfile, "goal [ %d ] . type . x = %c\n", j, type);
+
+		fprintf(outfile, "\n");
+	}
+	freeItemArray(&rotations);
+
+	decodeLegacyRotations(lz, bumpers, 0x20, STAGE_BIG_ENDIAN, &rotations);
+	stageSeek(lz, bumpers.offset, SEEK_SET);
+
+	for (int j = 0; j < bumpers.number; ++j) {
+		float xPos = readFloat(lz);
+		float yPos = readFloat(lz);
+		float zPos = readFloat(lz);
+
+		float xRot, yRot, zRot;
+		ENDIAN_NAME(readLegacyRotation)(lz, &rotations, j, &xRot, &yRot, &zRot);
+
+		stageSeek(lz, 2, SEEK_CUR);
+
+		float xScl = readFloat(lz);
+		float yScl = readFloat(lz);
+		float zScl = readFloat(lz);
+
+		fprintf(outfile, "bumper [ %d ] . pos . x = %f\n", j, xPos);
+		fprintf(outfile, "bumper [ %d ] . pos . y = %f\n", j, yPos);
+		fprintf(outfile, "bumper [ %d ] . pos . z = %f\n", j, zPos);
+
+		fprintf(outfile, "bumper [ %d ] . rot . x = %f\n", j, xRot);
+		fprintf(outfile, "bumper [ %d ] . rot . y = %f\n", j, yRot);
+		fprintf(outfile, "bumper [ %d ] . rot . z = %f\n", j, zRot);
+
+		fprintf(outfile, "bumper [ %d ] . scl . x = %f\n", j, xScl);
+		fprintf(outfile, "bumper [ %d ] . scl . y = %f\n", j, yScl);
+		fprintf(outfile, "bumper [ %d ] . scl . z = %f\n", j, zScl);
+
+		fprintf(outfile, "\n");
+	}
+	freeItemArray(&rotations);
+
+	decodeLegacyRotations(lz, jamabars, 0x20, STAGE_BIG_ENDIAN, &rotations);
+	stageSeek(lz, jamabars.offset, SEEK_SET);
+
+	for (int j = 0; j < jamabars.number; ++j) {
+		float xPos = readFloat(lz);
+		float yPos = readFloat(lz);
+		float zPos = readFloat(lz);
+
+		float xRot, yRot, zRot;
+		ENDIAN_NAME(readLegacyRotation)(lz, &rotations, j, &xRot, &yRot, &zRot);
+
+		stageSeek(lz, 2, SEEK_CUR);
+
+		float xScl = readFloat(lz);
+		float yScl = readFloat(lz);
+		float zScl = readFloat(lz);
+
+		fprintf(outfile, "jamabar [ %d ] . pos . x = %f\n", j, xPos);
+		fprintf(outfile, "jamabar [ %d ] . pos . y = %f\n", j, yPos);
+		fprintf(outfile, "jamabar [ %d ] . pos . z = %f\n", j, zPos);
+
+		fprintf(outfile, "jamabar [ %d ] . rot . x = %f\n", j, xRot);
+		fprintf(outfile, "jamabar [ %d ] . rot . y = %f\n", j, yRot);
+		fprintf(outfile, "jamabar [ %d ] . rot . z = %f\n", j, zRot);
+
+
+		fprintf(outfile, "jamabar [ %d ] . scl . x = %f\n", j, xScl);
+		fprintf(outfile, "jamabar [ %d ] . scl . y = %f\n", j, yScl);
+		fprintf(outfile, "jamabar [ %d ] . scl . z = %f\n", j, zScl);
+
+		fprintf(outfile, "\n");
+	}
+	freeItemArray(&rotations);
+
+	stageSeek(lz, bananas.offset, SEEK_SET);
+
+	for (int j = 0; j < bananas.number; ++j) {
+		float xPos = readFloat(lz);
+		float yPos = readFloat(lz);
+		float zPos = readFloat(lz);
+
+		int intType = readInt(lz);
+		char type = 'N';
+		if (intType == 1) {
+			type = 'B';
+		}
+
+		fprintf(outfile, "banana [ %d ] . pos . x = %f\n", j, xPos);
+		fprintf(outfile, "banana [ %d ] . pos . y = %f\n", j, yPos);
+		fprintf(outfile, "banana [ %d ] . pos . z = %f\n", j, zPos);
+
+		fprintf(outfile, "banana [ %d ] . type . x = %c\n", j, type);
+
+		fprintf(outfile, "\n");
+	}
+
+	if (game == SMB1) {
+		int numAnims = 0;
+		stageSeek(lz, collisionFields.offset, SEEK_SET);
+
+		for (int j = 0; j < collisionFields.number; ++j) {
+
+
+			float xPosCenter = readFloat(lz);
+			float yPosCenter = readFloat(lz);
+			float zPosCenter = readFloat(lz);
+
+			float xRotCenter = readRot(lz);
+			float yRotCenter = readRot(lz);
+			float zRotCenter = readRot(lz);
+
+			stageSeek(lz, 2, SEEK_CUR);
+
+			int animationFrameOffset = readInt(lz);
+
+			if (!animationFrameOffset) {
+				stageSeek(lz, 172, SEEK_CUR);
+				continue;
+			}
+
+			++numAnims;
+
+			int nameOffsetOffset = readInt(lz);
+
+			int position = stageTell(lz);
+
+			stageSeek(lz, nameOffsetOffset, SEEK_SET);
+			int nameOffset = readInt(lz);
+			char modelName[512];
+			char animFilename[512];
+
+			readLegacyName(lz, names, nameOffset, modelName, 501);
+			stageSeek(lz, position, SEEK_SET);
+
+			strcpy(animFilename, modelName);
+
+			int animObjlength = (int)strlen(animFilename);
+			animFilename[animObjlength + 0] = 'a';
+			animFilename[animObjlength + 1] = 'n';
+			animFilename[animObjlength + 2] = 'i';
+			animFilename[animObjlength + 3] = 'm';
+			animFilename[animObjlength + 4] = '.';
+			animFilename[animObjlength + 5] = 't';
+			animFilename[animObjlength + 6] = 'x';
+			animFilename[animObjlength + 7] = 't';
+			animFilename[animObjlength + 8] = '\0';
+
+			int numFrames = 0;
+			AnimFrame animFrames[4096];
+
+			memset(animFrames, 0, 120 * sizeof(AnimFrame));
+
+			stageSeek(lz, animationFrameOffset, SEEK_SET);
+			int numXRot = readInt(lz);
+			int offsetXRot = readInt(lz);
+			int numYRot = readInt(lz);
+			int offsetYRot = readInt(lz);
+			int numZRot = readInt(lz);
+			int offsetZRot = readInt(lz);
+
+			int numXPos = readInt(lz);
+			int offsetXPos = readInt(lz);
+			int numYPos = readInt(lz);
+			int offsetYPos = readInt(lz);
+			int numZPos = readInt(lz);
+			int offsetZPos = readInt(lz);
+
+			// First Pass: Collect Frame Times
+
+			stageSeek(lz, offsetXRot + 4, SEEK_SET);
+			for (int k = 0; k < numXRot; ++k) {
+				numFrames += insert(animFrames, numFrames, readFloat(lz));
+				stageSeek(lz, 16, SEEK_CUR);
+			}
+
+			stageSeek(lz, offsetYRot + 4, SEEK_SET);
+			for (int k = 0; k < numYRot; ++k) {
+				numFrames += insert(animFrames, numFrames, readFloat(lz));
+				stageSeek(lz, 16, SEEK_CUR);
+			}
+
+			stageSeek(lz, offsetZRot + 4, SEEK_SET);
+			for (int k = 0; k < numZRot; ++k) {
+				numFrames += insert(animFrames, numFrames, readFloat(lz));
+				stageSeek(lz, 16, SEEK_CUR);
+			}
+
+
+			stageSeek(lz, offsetXPos + 4, SEEK_SET);
+			for (int k = 0; k < numXPos; ++k) {
+				numFrames += insert(animFrames, numFrames, readFloat(lz));
+				stageSeek(lz, 16, SEEK_CUR);
+			}
+
+			stageSeek(lz, offsetYPos + 4, SEEK_SET);
+			for (int k = 0; k < numYPos; ++k) {
+				numFrames += insert(animFrames, numFrames, readFloat(lz));
+				stageSeek(lz, 16, SEEK_CUR);
+			}
+
+			stageSeek(lz, offsetZPos + 4, SEEK_SET);
+			for (int k = 0; k < numZPos; ++k) {
+				numFrames += insert(animFrames, numFrames, readFloat(lz));
+				stageSeek(lz, 16, SEEK_CUR);
+			}
+
+			// Second Pass: Collect Frame Data
+
+			for (int k = 0; k < numFrames; ++k) {
+
+				float prevTime = 0;
+				float prevAmount = 0;
+				char found = 0;
+
+				// Go all from data for this axis
+				stageSeek(lz, offsetXRot + 4, SEEK_SET);
+				for (int l = 0; l < numXRot; ++l) {
+					// Get the time and translation/rotation
+					float time = readFloat(lz);
+					float amount = readFloat(lz);
+
+					// If times match up, insert it
+					if (time == animFrames[k].time) {
+						animFrames[k].xRot = amount;
+						found = 1;
+						break;
+					}// If the time is too far, extrapolate
+					else if (time > animFrames[k].time) {
+						float fractionTime = time / prevTime;
+						float fractionAmount = (prevAmount + amount) * fractionTime;
+						animFrames[k].xRot = fractionAmount;
+						found = 1;
+						break;
+					}
+					prevTime = time;
+					prevAmount = amount;
+					stageSeek(lz, 12, SEEK_CUR);
+				}
+
+				if (!found) {
+					animFrames[k].xRot = 0;
+				}
+
+				found = 0;
+
+				// Go all from data for this axis
+				stageSeek(lz, (offsetYRot + 4), SEEK_SET);
+				for (int l = 0; l < numYRot; ++l) {
+					// Get the time and translation/rotation
+					float time = readFloat(lz);
+					float amount = readFloat(lz);
+
+					// If times match up, insert it
+					if (time == animFrames[k].time) {
+						animFrames[k].yRot = amount;
+						found = 1;
+						break;
+					}// If the time is too far, extrapolate
+					else if (time > animFrames[k].time) {
+						float fractionTime = time / prevTime;
+						float fractionAmount = (prevAmount + amount) * fractionTime;
+						animFrames[k].yRot = fractionAmount;
+						found = 1;
+						break;
+					}
+					prevTime = time;
+					prevAmount = amount;
+					stageSeek(lz, 12, SEEK_CUR);
+				}
+
+
+				if (!found) {
+					animFrames[k].yRot = 0;
+				}
+
+				found = 0;
+				// Go all from data for this axis
+				stageSeek(lz, (offsetZRot + 4), SEEK_SET);
+				for (int l = 0; l < numZRot; ++l) {
+					// Get the time and translation/rotation
+					float time = readFloat(lz);
+					float amount = readFloat(lz);
+
+					// If times match up, insert it
+					if (time == animFrames[k].time) {
+						animFrames[k].zRot = amount;
+						found = 1;
+						break;
+					}// If the time is too far, extrapolate
+					else if (time > animFrames[k].time) {
+						float fractionTime = time / prevTime;
+						float fractionAmount = (prevAmount + amount) * fractionTime;
+						animFrames[k].zRot = fractionAmount;
+						found = 1;
+						break;
+					}
+					prevTime = time;
+					prevAmount = amount;
+					stageSeek(lz, 12, SEEK_CUR);
+				}
+
+
+				if (!found) {
+					animFrames[k].zRot = 0;
+				}
+
+				found = 0;
+				// Go all from data for this axis
+				stageSeek(lz, (offsetXPos + 4), SEEK_SET);
+				for (int l = 0; l < numXPos; ++l) {
+					// Get the time and translation/rotation
+					float time = readFloat(lz);
+					float amount = readFloat(lz);
+
+					// If times match up, insert it
+					if (time == animFrames[k].time) {
+						animFrames[k].xPos = amount;
+						found = 1;
+						break;
+					}// If the time is too far, extrapolate
+					else if (time > animFrames[k].time) {
+						float fractionTime = time / prevTime;
+						float fractionAmount = (prevAmount + amount) * fractionTime;
+						animFrames[k].xPos = fractionAmount;
+						found = 1;
+						break;
+					}
+					prevTime = time;
+					prevAmount = amount;
+					stageSeek(lz, 12, SEEK_CUR);
+				}
+
+				if (!found) {
+					animFrames[k].xPos = 0;
+				}
+
+				found = 0;
+				// Go all from data for this axis
+				stageSeek(lz, (offsetYPos + 4), SEEK_SET);
+				for (int l = 0; l < numYPos; ++l) {
+					// Get the time and translation/rotation
+					float time = readFloat(lz);
+					float amount = readFloat(lz);
+
+					// If times match up, insert it
+					if (time == animFrames[k].time) {
+						animFrames[k].yPos = amount;
+						found = 1;
+						break;
+					}// If the time is too far, extrapolate
+					else if (time > animFrames[k].time) {
+						float fractionTime = time / prevTime;
+						float fractionAmount = (prevAmount + amount) * fractionTime;
+						animFrames[k].yPos = fractionAmount;
+						found = 1;
+						break;
+					}
+					prevTime = time;
+					prevAmount = amount;
+					stageSeek(lz, 12, SEEK_CUR);
+				}
+
+				if (!found) {
+					animFrames[k].yPos = 0;
+				}
+
+				found = 0;
+				// Go all from data for this axis
+				stageSeek(lz, (offsetZPos + 4), SEEK_SET);
+				for (int l = 0; l < numZPos; ++l) {
+					// Get the time and translation/rotation
+					float time = readFloat(lz);
+					float amount = readFloat(lz);
+
+					// If times match up, insert it
+					if (time == animFrames[k].time) {
+						animFrames[k].zPos = amount;
+						found = 1;
+						break;
+					}// If the time is too far, extrapolate
+					else if (time > animFrames[k].time) {
+						float fractionTime = time / prevTime;
+						float fractionAmount = (prevAmount + amount) * fractionTime;
+						animFrames[k].zPos = fractionAmount;
+						found = 1;
+						break;
+					}
+					prevTime = time;
+					prevAmount = amount;
+					stageSeek(lz, 12, SEEK_CUR);
+				}
+
+				if (!found) {
+					animFrames[k].zPos = 0;
+				}
+
+			}
+
+
+			stageSeek(lz, position, SEEK_SET);
+			stageSeek(lz, 168, SEEK_CUR);
+
+			// Third Pass: Write the information
+
+			fprintf(outfile, "animobj [ %d ] . file . x = %s\n", numAnims, animFilename);
+			fprintf(outfile, "animobj [ %d ] . name . x = %s\n", numAnims, modelName);
+			fprintf(outfile, "animobj [ %d ] . center . x = %f\n", numAnims, xPosCenter);
+			fprintf(outfile, "animobj [ %d ] . center . y = %f\n", numAnims, yPosCenter);
+			fprintf(outfile, "animobj [ %d ] . center . z = %f\n", numAnims, zPosCenter);
+			fprintf(outfile, "\n");
+
+			FILE* animFile = fopen(animFilename, "w");
+
+			for (int k = 0; k < numFrames; ++k) {
+				fprintf(animFile, "frame [ %d ] . time . x = %f\n", k, animFrames[k].time);
+
+				fprintf(animFile, "frame [ %d ] . pos . x = %f\n", k, animFrames[k].xPos);
+				fprintf(animFile, "frame [ %d ] . pos . y = %f\n", k, animFrames[k].yPos);
+				fprintf(animFile, "frame [ %d ] . pos . z = %f\n", k, animFrames[k].zPos);
+
+				fprintf(animFile, "frame [ %d ] . rot . x = %f\n", k, animFrames[k].xRot + xRotCenter);
+				fprintf(animFile, "frame [ %d ] . rot . y = %f\n", k, animFrames[k].yRot + yRotCenter);
+				fprintf(animFile, "frame [ %d ] . rot . z = %f\n", k, animFrames[k].zRot + zRotCenter);
+
+				fprintf(animFile, "\n");
+			}
+			fclose(animFile);
+
+		}
+	}
+
+
+
+	stageSeek(lz, backgrounds.offset, SEEK_SET);
+
+	for (int j = 0; j < backgrounds.number; ++j) {
+
+
+		stageSeek(lz, 4, SEEK_CUR);
+		int nameOffset = readInt(lz);
+
+		int position = stageTell(lz);
+
+		char modelName[512];
+
+		readLegacyName(lz, names, nameOffset, modelName, 511);
+		stageSeek(lz, position, SEEK_SET);
+
+		stageSeek(lz, 48, SEEK_CUR);
+
+		fprintf(outfile, "background [ %d ] . name . x = %s\n", j, modelName);
+
+
+	}
+
+	if (backgrounds.number == 0) {
+		fprintf(outfile, "\n");
+	}
+
+	int result = ferror(outfile) ? -1 : 0;
+	if (fclose(outfile) != 0) {
+		result = -1;
+	}
+	return result;
+}
@@ -0,0 +1,341 @@
+#include "lzss.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LZSS_USE_SSE2
+#endif
+
+#include "FunctionsAndDefines.h"
+
+// The wide copy kernel may write this many bytes past the start of a reference
+// Define LZSS_BYTE_COPY to copy every reference a byte at a time instead (the benchmark compares the two)
+#define LZSS_COPY_SLACK 32
+
+static const int inc32table[8] = { 0, 1, 2, 1, 0, 4, 4, 4 };
+static const int dec64table[8] = { 0, 0, 0, -1, -4, 1, 2, 3 };
+
+// Copies a reference of 3-18 bytes that starts distance bytes behind dst
+// Writes up to LZSS_COPY_SLACK bytes, anything past length is overwritten by later data
+static inline void copyReference(uint8_t *dst, uint32_t distance, uint32_t length) {
+	const uint8_t *src = dst - distance;
+
+#ifdef LZSS_USE_SSE2
+	// Far enough back that 16 byte chunks never read bytes they haven't written yet
+	if (distance >= 16) {
+		_mm_storeu_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+		if (length > 16) {
+			_mm_storeu_si128((__m128i *)(dst + 16), _mm_loadu_si128((const __m128i *)(src + 16)));
+		}
+		return;
+	}
+#endif
+
+	// Run of a single byte, broadcast it across a word
+	if (distance == 1) {
+		uint64_t run = 0x0101010101010101ULL * src[0];
+		memcpy(dst, &run, 8);
+		memcpy(dst + 8, &run, 8);
+		memcpy(dst + 16, &run, 8);
+		return;
+	}
+
+	// Short repeating pattern, copy the first 8 bytes by hand until the gap is a full word
+	if (distance < 8) {
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		dst[3] = src[3];
+		src += inc32table[distance];
+		memcpy(dst + 4, src, 4);
+		src -= dec64table[distance];
+		dst += 8;
+		if (length <= 8) {
+			return;
+		}
+		length -= 8;
+	}
+
+	// 8 byte chunks, each chunk only reads bytes that were already final
+	memcpy(dst, src, 8);
+	if (length > 8) {
+		memcpy(dst + 8, src + 8, 8);
+		if (length > 16) {
+			memcpy(dst + 16, src + 16, 8);
+		}
+	}
+}
+
+// Decodes until at least stopPos bytes are out, output only has to hold stopPos bytes
+// outputSize is the size of the whole stream and is only used to catch corrupt references
+// Counts into stats when it isn't NULL, only references are counted in the loop itself
+// Returns the number of bytes decoded or -1 on corrupt data
+static int64_t decodeUntil(const uint8_t *input, uint32_t inputSize, uint8_t *output, uint32_t outputSize, uint32_t stopPos, LZSSStats *stats) {
+	uint32_t inPos = 0;
+	uint32_t outPos = 0;
+	uint32_t referenceBytes = 0;
+	if (stats != NULL) {
+		memset(stats, 0, sizeof(LZSSStats));
+	}
+
+	// Loop until we reach the end of the data or have everything asked for
+	while (inPos < inputSize && outPos < stopPos) {
+		// Read the first control block
+		// Read right to left, each bit specifies how the the next 8 spots of data will be
+		// 1 means write the byte directly to the output
+		// 0 represents there will be reference (2 byte)
+		uint8_t block = input[inPos++];
+
+		// Go through every bit in the control block
+		for (int j = 0; j < 8 && inPos < inputSize && outPos < stopPos; ++j) {
+			// Literal
+			if (block & 0x01) {
+				output[outPos++] = input[inPos++];
+			}// Reference
+			else {
+				// A truncated reference means the stream is done
+				if (inPos + 2 > inputSize) {
+					inPos = inputSize;
+					break;
+				}
+				uint16_t reference = (uint16_t)((input[inPos] << 8) | input[inPos + 1]);
+				inPos += 2;
+
+				// Length is the last nibble (last 4 bits) of the 2 reference bytes + 3
+				// Any less than a lengh of 3 i pointess since a reference takes up 3 bytes
+				uint32_t length = (reference & 0x000F) + 3;
+
+				// Offset if is all 8 bits in the first reference byte and the first nibble (4 bits) in the second reference byte
+				// The nibble from the second reference byte comes before the first reference byte
+				// EX: reference bytes = 0x12 0x34
+				//     offset = 0x312
+				uint32_t offset = ((reference & 0xFF00) >> 8) | ((reference & 0x00F0) << 4);
+
+				// Convert the offset to how many bytes away from the end of the buffer to start reading from
+				// A distance of 0 wraps all the way around the window
+				uint32_t backSet = (outPos - 18 - offset) & (LZSS_WINDOW_SIZE - 1);
+				if (backSet == 0) {
+					backSet = LZSS_WINDOW_SIZE;
+				}
+
+				// A reference past the expected size means the archive is corrupt
+				if (length > outputSize - outPos) {
+					return -1;
+				}
+				// Only the start of the last reference is needed when stopping early
+				if (length > stopPos - outPos) {
+					length = stopPos - outPos;
+				}
+
+				if (stats != NULL) {
+					stats->references++;
+					stats->lengthHistogram[length - 3 < LZSS_LENGTH_BUCKETS ? length - 3 : 0]++;
+					uint32_t bucket = 0;
+					while ((backSet >> (bucket + 1)) != 0) {
+						bucket++;
+					}
+					stats->distanceHistogram[bucket]++;
+					if (backSet > outPos) {
+						stats->zeroFillReferences++;
+					}
+					referenceBytes += length;
+				}
+
+				// Handle case where the offset is past the beginning of the output
+				while (backSet > outPos && length > 0) {
+					output[outPos++] = 0;
+					--length;
+				}
+
+				// Use the wide copy when there is room for it to overshoot
+				if (length == 0) {
+					// Entirely before the beginning of the output
+				}
+#ifndef LZSS_BYTE_COPY
+				else if (stopPos - outPos >= LZSS_COPY_SLACK) {
+					copyReference(output + outPos, backSet, length);
+					outPos += length;
+				}
+#endif
+				else {
+					// Copy forward one byte at a time so overlapping references repeat correctly
+					const uint8_t *source = output + outPos - backSet;
+					while (length > 0) {
+						output[outPos++] = *source++;
+						--length;
+					}
+				}
+			}
+			// Go to the next reference bit in the block
+			block = block >> 1;
+		}
+	}
+
+	if (stats != NULL) {
+		stats->bytesIn = inPos;
+		stats->bytesOut = outPos;
+		stats->literals = outPos - referenceBytes;
+	}
+	return outPos;
+}
+
+int lzssDecode(const uint8_t *input, uint32_t inputSize, uint8_t *output, uint32_t outputSize) {
+	return decodeUntil(input, inputSize, output, outputSize, outputSize, NULL) == outputSize ? 0 : -1;
+}
+
+int lzssDecodeStats(const uint8_t *input, uint32_t inputSize, uint8_t *output, uint32_t outputSize, LZSSStats *stats) {
+	return decodeUntil(input, inputSize, output, outputSize, outputSize, stats) == outputSize ? 0 : -1;
+}
+
+int lzssDecodePrefix(const uint8_t *input, uint32_t inputSize, uint8_t *output, uint32_t outputSize, uint32_t prefixSize) {
+	if (prefixSize > outputSize) {
+		return -1;
+	}
+	return decodeUntil(input, inputSize, output, outputSize, prefixSize, NULL) == prefixSize ? 0 : -1;
+}
+
+void lzssStreamInit(LZSSStream *stream, uint32_t outputSize) {
+	// A zeroed window doubles as the zero fill for references before the start
+	memset(stream->window, 0, sizeof(stream->window));
+	stream->outputSize = outputSize;
+	stream->stopPos = outputSize;
+	stream->outPos = 0;
+	stream->flushedPos = 0;
+	stream->block = 0;
+	stream->blockBits = 0;
+	stream->referenceHigh = -1;
+	stream->error = 0;
+}
+
+void lzssStreamResume(LZSSStream *stream, uint32_t outputSize, uint32_t outPos, const uint8_t *window) {
+	lzssStreamInit(stream, outputSize);
+	memcpy(stream->window, window, sizeof(stream->window));
+	stream->outPos = outPos;
+	stream->flushedPos = outPos;
+}
+
+// Hands everything decoded since the last flush to the sink
+static int flushStream(LZSSStream *stream, LZSSSink sink, void *userData) {
+	uint32_t pending = stream->outPos - stream->flushedPos;
+	if (pending == 0) {
+		return 0;
+	}
+	uint32_t start = stream->flushedPos & (LZSS_WINDOW_SIZE - 1);
+	uint32_t firstPart = LZSS_WINDOW_SIZE - start;
+	if (firstPart > pending) {
+		firstPart = pending;
+	}
+	if (sink(userData, stream->window + start, firstPart) != 0) {
+		return -1;
+	}
+	if (pending > firstPart && sink(userData, stream->window, pending - firstPart) != 0) {
+		return -1;
+	}
+	stream->flushedPos = stream->outPos;
+	return 0;
+}
+
+static inline int putStreamByte(LZSSStream *stream, uint8_t value, LZSSSink sink, void *userData) {
+	stream->window[stream->outPos & (LZSS_WINDOW_SIZE - 1)] = value;
+	stream->outPos++;
+	// Flush before the window wraps around onto data the sink hasn't seen
+	if (stream->outPos - stream->flushedPos == LZSS_WINDOW_SIZE) {
+		return flushStream(stream, sink, userData);
+	}
+	return 0;
+}
+
+int lzssStreamFeed(LZSSStream *stream, const uint8_t *input, uint32_t inputSize, LZSSSink sink, void *userData) {
+	if (stream->error) {
+		return -1;
+	}
+
+	uint32_t inPos = 0;
+	while (inPos < inputSize && stream->outPos < stream->stopPos) {
+		// Read the next control block
+		if (stream->blockBits == 0) {
+			stream->block = input[inPos++];
+			stream->blockBits = 8;
+			continue;
+		}
+
+		// Literal
+		if (stream->block & 0x01) {
+			if (putStreamByte(stream, input[inPos++], sink, userData) != 0) {
+				stream->error = 1;
+				return -1;
+			}
+		}// Reference (the two bytes may arrive in different chunks)
+		else {
+			if (stream->referenceHigh < 0) {
+				stream->referenceHigh = input[inPos++];
+				if (inPos == inputSize) {
+					break;
+				}
+			}
+			uint16_t reference = (uint16_t)((stream->referenceHigh << 8) | input[inPos++]);
+			stream->referenceHigh = -1;
+
+			uint32_t length = (reference & 0x000F) + 3;
+			uint32_t offset = ((reference & 0xFF00) >> 8) | ((reference & 0x00F0) << 4);
+			uint32_t backSet = (stream->outPos - 18 - offset) & (LZSS_WINDOW_SIZE - 1);
+			if (backSet == 0) {
+				backSet = LZSS_WINDOW_SIZE;
+			}
+			if (length > stream->outputSize - stream->outPos) {
+				stream->error = 1;
+				return -1;
+			}
+
+			// The window starts zeroed, so references before the start read zeros
+			uint32_t source = stream->outPos - backSet;
+			while (length > 0) {
+				if (putStreamByte(stream, stream->window[source & (LZSS_WINDOW_SIZE - 1)], sink, userData) != 0) {
+					stream->error = 1;
+					return -1;
+				}
+				++source;
+				--length;
+			}
+		}
+		// Go to the next reference bit in the block
+		stream->block = stream->block >> 1;
+		stream->blockBits--;
+	}
+	return 0;
+}
+
+int lzssStreamFlush(LZSSStream *stream, LZSSSink sink, void *userData) {
+	if (stream->error || flushStream(stream, sink, userData) != 0) {
+		return -1;
+	}
+	return 0;
+}
+
+int lzssStreamFinish(LZSSStream *stream, LZSSSink sink, void *userData) {
+	if (lzssStreamFlush(stream, sink, userData) != 0) {
+		return -1;
+	}
+	return stream->outPos == stream->outputSize ? 0 : -1;
+}
+
+int readSMBLZHeader(const uint8_t *lz, uint32_t lzSize, SMBLZHeader *header) {
+	if (lzSize < SMB_LZ_HEADER_SIZE) {
+		return -1;
+	}
+	header->compressedSize = readLittleIntData(lz, 0);
+	header->decompressedSize = readLittleIntData(lz, 4);
+
+	// The data can't be shorter than the header or longer than the file
+	if (header->compressedSize < SMB_LZ_HEADER_SIZE || header->compressedSize > lzSize) {
+		return -1;
+	}
+
+	// Reject sizes no LZSS stream of this length could decode to
+	uint32_t dataSize = header->compressedSize - SMB_LZ_HEADER_SIZE;
+	if ((uint64_t)header->decompressedSize > (uint64_t)dataSize * LZSS_MAX_EXPANSION) {
+		return -1;
+	}
+	return 0;
+}
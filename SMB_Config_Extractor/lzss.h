@@ -0,0 +1,133 @@
+#pragma once
+#include <stdint.h>
+
+// Size of the LZSS sliding window
+#define LZSS_WINDOW_SIZE 0x1000
+
+// The most a stream can expand: a control byte and 8 references (17 bytes) produce 8 * 18 bytes
+#define LZSS_MAX_EXPANSION 9
+
+// SMB lz files start with two little endian words instead of FF7's single size word
+// 0x0 Compressed size (including this header)
+// 0x4 Decompressed size
+#define SMB_LZ_HEADER_SIZE 8
+
+typedef struct {
+	uint32_t compressedSize;
+	uint32_t decompressedSize;
+}SMBLZHeader;
+
+// Reads and sanity checks the SMB lz header
+// lzSize is the size of the whole lz file, only the first SMB_LZ_HEADER_SIZE bytes of lz are read
+// Returns 0 if the header is usable, -1 otherwise
+int readSMBLZHeader(const uint8_t *lz, uint32_t lzSize, SMBLZHeader *header);
+
+// Decodes an FF7 style LZSS stream (no header) into a caller allocated buffer of exactly outputSize bytes
+// Returns 0 if the stream decoded to exactly outputSize bytes, -1 otherwise
+int lzssDecode(const uint8_t *input, uint32_t inputSize, uint8_t *output, uint32_t outputSize);
+// Reference lengths run from 3 to 18
+#define LZSS_LENGTH_BUCKETS 16
+// Bucket n holds distances from 2^n up to 2^(n + 1) - 1, the last one is exactly 4096
+#define LZSS_DISTANCE_BUCKETS 13
+
+typedef struct {
+	uint32_t bytesIn;
+	uint32_t bytesOut;
+	uint32_t literals;
+	uint32_t references;
+	uint32_t zeroFillReferences;   // References that start before the beginning of the output
+	uint32_t lengthHistogram[LZSS_LENGTH_BUCKETS];
+	uint32_t distanceHistogram[LZSS_DISTANCE_BUCKETS];
+}LZSSStats;
+
+// lzssDecode that also counts what the stream is made of
+int lzssDecodeStats(const uint8_t *input, uint32_t inputSize, uint8_t *output, uint32_t outputSize, LZSSStats *stats);
+
+// Decodes only the first prefixSize bytes of a stream that decodes to outputSize bytes, then stops
+// output only has to hold prefixSize bytes
+// Returns 0 if the prefix decoded, -1 otherwise
+int lzssDecodePrefix(const uint8_t *input, uint32_t inputSize, uint8_t *output, uint32_t outputSize, uint32_t prefixSize);
+// Most stream bytes the first prefixSize bytes of output can take (all literals, plus a last reference)
+#define LZSS_PREFIX_INPUT_BOUND(prefixSize) ((prefixSize) + ((prefixSize) + 7) / 8 + 2)
+
+// Receives decoded data in order, return non-zero to stop decoding
+typedef int(*LZSSSink)(void *userData, const uint8_t *data, uint32_t size);
+
+// Streaming decoder state, only the 4 KB window is kept resident
+typedef struct {
+	uint8_t window[LZSS_WINDOW_SIZE];
+	uint32_t outputSize;
+	uint32_t stopPos;     // Feeding stops once outPos reaches this
+	uint32_t outPos;
+	uint32_t flushedPos;
+	uint8_t block;
+	int blockBits;
+	int referenceHigh;
+	int error;
+}LZSSStream;
+
+// Starts a stream that decodes to outputSize bytes (the SMB header's decompressed size)
+void lzssStreamInit(LZSSStream *stream, uint32_t outputSize);
+// Starts a stream part way through from a control block boundary, window holds the 4 KB before outPos
+// The window is laid out as the stream keeps it, byte n of the output lives at window[n & 0xFFF]
+void lzssStreamResume(LZSSStream *stream, uint32_t outputSize, uint32_t outPos, const uint8_t *window);
+// Decodes the next chunk of the LZSS stream (no header), chunks can split anywhere
+// Full windows are handed to sink as they are completed
+// Returns 0 on success, -1 on corrupt data or if sink asked to stop
+int lzssStreamFeed(LZSSStream *stream, const uint8_t *input, uint32_t inputSize, LZSSSink sink, void *userData);
+// Hands everything decoded so far to sink without ending the stream
+// Returns 0 on success, -1 if sink asked to stop
+int lzssStreamFlush(LZSSStream *stream, LZSSSink sink, void *userData);
+// Hands the rest of the window to sink
+// Returns 0 if exactly outputSize bytes were decoded, -1 otherwise
+int lzssStreamFinish(LZSSStream *stream, LZSSSink sink, void *userData);
+
+// Default spacing of seek index checkpoints in decompressed bytes
+#define LZSS_INDEX_INTERVAL 0x4000
+
+// Decoder state at the start of a control block
+typedef struct {
+	uint32_t outPos;
+	uint32_t inPos;    // Relative to the start of the LZSS stream (after the SMB header)
+	uint8_t window[LZSS_WINDOW_SIZE];
+}LZSSCheckpoint;
+
+// Seek index for an SMB lz file, stored next to it as <FILE>.idx
+// Checkpoint n covers the output from its outPos up to the next checkpoint's
+typedef struct {
+	uint32_t interval;
+	uint32_t compressedSize;
+	uint32_t decompressedSize;
+	uint64_t lzHash;   // FNV-1a of the whole lz file, catches a stale index
+	uint32_t checkpointCount;
+	LZSSCheckpoint *checkpoints;
+}LZSSIndex;
+
+// Builds an index for a whole lz file (header included) from its already decompressed data
+// A checkpoint is placed at the first control block at or after every interval bytes of output
+// Returns 0 on success, -1 on failure
+int lzssBuildIndex(const uint8_t *lz, uint32_t lzSize, const uint8_t *decompressed, uint32_t interval, LZSSIndex *index);
+int lzssWriteIndex(const char *filename, const LZSSIndex *index);
+// Returns 0 if filename holds a well formed index, -1 otherwise
+int lzssReadIndex(const char *filename, LZSSIndex *index);
+void lzssFreeIndex(LZSSIndex *index);
+// Returns 1 if index was built from this exact lz file
+int lzssIndexMatches(const LZSSIndex *index, const uint8_t *lz, uint32_t lzSize);
+// Returns the checkpoint whose range contains the output position pos
+uint32_t lzssIndexFindChunk(const LZSSIndex *index, uint32_t pos);
+// Returns the output position where a checkpoint's range ends
+uint32_t lzssIndexChunkEnd(const LZSSIndex *index, uint32_t chunk);
+// Decodes only the range of one checkpoint into its place in output (a buffer of decompressedSize bytes)
+// Returns 0 on success, -1 on corrupt data
+int lzssDecodeChunk(const uint8_t *lz, uint32_t lzSize, const LZSSIndex *index, uint32_t chunk, uint8_t *output);
+
+enum LZSS_LEVEL {
+	LZSS_LEVEL_FAST = 1,    // Greedy parse with short hash chains
+	LZSS_LEVEL_NORMAL = 2,  // Lazy parse
+	LZSS_LEVEL_OPTIMAL = 3  // Optimal parse over every match in the window
+};
+
+// Compresses data into a complete SMB lz file (header included)
+// On success *output points to a heap buffer of *outputSize bytes the caller must free
+// Returns 0 on success, -1 on failure
+int lzssCompressSMB(const uint8_t *input, uint32_t inputSize, int level, uint8_t **output, uint32_t *outputSize);
@@ -0,0 +1,265 @@
+#include "lzss.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "FunctionsAndDefines.h"
+
+#define MIN_MATCH 3
+#define MAX_MATCH 18
+// A distance of 0 would wrap around the whole window, stay one short of that
+#define MAX_DISTANCE (LZSS_WINDOW_SIZE - 1)
+
+#define HASH_BITS 13
+#define HASH_SIZE (1 << HASH_BITS)
+#define NO_POSITION 0xFFFFFFFF
+
+// Costs in bits (including the control bit) used by the optimal parser
+#define LITERAL_COST 9
+#define REFERENCE_COST 17
+
+typedef struct {
+	const uint8_t *input;
+	uint32_t inputSize;
+	uint32_t head[HASH_SIZE];
+	uint32_t prev[LZSS_WINDOW_SIZE];
+	uint32_t nextInsert;
+	int maxChain;
+}MatchFinder;
+
+typedef struct {
+	uint8_t *output;
+	uint32_t outPos;
+	uint32_t controlPos;
+	int controlBit;
+}LZSSWriter;
+
+static inline uint32_t hash3(const uint8_t *data) {
+	uint32_t value = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+	return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void initMatchFinder(MatchFinder *finder, const uint8_t *input, uint32_t inputSize, int maxChain) {
+	finder->input = input;
+	finder->inputSize = inputSize;
+	finder->nextInsert = 0;
+	finder->maxChain = maxChain;
+	for (int i = 0; i < HASH_SIZE; i++) {
+		finder->head[i] = NO_POSITION;
+	}
+}
+
+// Adds every position before pos to the hash chains
+static void insertUpTo(MatchFinder *finder, uint32_t pos) {
+	while (finder->nextInsert < pos && finder->nextInsert + MIN_MATCH <= finder->inputSize) {
+		uint32_t h = hash3(finder->input + finder->nextInsert);
+		finder->prev[finder->nextInsert & (LZSS_WINDOW_SIZE - 1)] = finder->head[h];
+		finder->head[h] = finder->nextInsert;
+		finder->nextInsert++;
+	}
+}
+
+// Finds the longest match for pos within the window
+// Returns the length (0 if nothing usable) and sets *distance
+static uint32_t findMatch(MatchFinder *finder, uint32_t pos, uint32_t *distance) {
+	insertUpTo(finder, pos);
+	if (pos + MIN_MATCH > finder->inputSize) {
+		return 0;
+	}
+
+	const uint8_t *current = finder->input + pos;
+	uint32_t maxLength = finder->inputSize - pos;
+	if (maxLength > MAX_MATCH) {
+		maxLength = MAX_MATCH;
+	}
+
+	uint32_t bestLength = 0;
+	uint32_t candidate = finder->head[hash3(current)];
+	for (int chain = 0; chain < finder->maxChain && candidate != NO_POSITION; chain++) {
+		uint32_t candidateDistance = pos - candidate;
+		if (candidateDistance > MAX_DISTANCE) {
+			break;
+		}
+
+		const uint8_t *match = finder->input + candidate;
+		if (match[bestLength] == current[bestLength]) {
+			uint32_t length = 0;
+			while (length < maxLength && match[length] == current[length]) {
+				length++;
+			}
+			if (length > bestLength) {
+				bestLength = length;
+				*distance = candidateDistance;
+				if (length == maxLength) {
+					break;
+				}
+			}
+		}
+
+		// Stop once the chain runs into entries the ring has already overwritten
+		uint32_t next = finder->prev[candidate & (LZSS_WINDOW_SIZE - 1)];
+		if (next == NO_POSITION || next >= candidate) {
+			break;
+		}
+		candidate = next;
+	}
+
+	return bestLength >= MIN_MATCH ? bestLength : 0;
+}
+
+static void startControlBlock(LZSSWriter *writer) {
+	writer->controlPos = writer->outPos++;
+	writer->output[writer->controlPos] = 0;
+	writer->controlBit = 0;
+}
+
+static void writeLiteral(LZSSWriter *writer, uint8_t literal) {
+	if (writer->controlBit == 8) {
+		startControlBlock(writer);
+	}
+	writer->output[writer->controlPos] |= (uint8_t)(1 << writer->controlBit++);
+	writer->output[writer->outPos++] = literal;
+}
+
+static void writeReference(LZSSWriter *writer, uint32_t pos, uint32_t distance, uint32_t length) {
+	if (writer->controlBit == 8) {
+		startControlBlock(writer);
+	}
+	writer->controlBit++;
+
+	// Inverse of the decoder: backSet = (pos - 18 - offset) & 0xFFF
+	uint32_t offset = (pos - 18 - distance) & (LZSS_WINDOW_SIZE - 1);
+	writer->output[writer->outPos++] = (uint8_t)(offset & 0xFF);
+	writer->output[writer->outPos++] = (uint8_t)(((offset >> 4) & 0xF0) | (length - MIN_MATCH));
+}
+
+// Greedy (and optionally lazy) parse, takes the longest match at each position
+static void parseGreedy(MatchFinder *finder, LZSSWriter *writer, int lazy) {
+	const uint8_t *input = finder->input;
+	uint32_t pos = 0;
+	while (pos < finder->inputSize) {
+		uint32_t distance = 0;
+		uint32_t length = findMatch(finder, pos, &distance);
+
+		// If the next position has a longer match, a literal here is cheaper
+		if (lazy && length > 0 && length < MAX_MATCH) {
+			uint32_t nextDistance = 0;
+			uint32_t nextLength = findMatch(finder, pos + 1, &nextDistance);
+			if (nextLength > length) {
+				writeLiteral(writer, input[pos]);
+				pos++;
+				continue;
+			}
+		}
+
+		if (length > 0) {
+			writeReference(writer, pos, distance, length);
+			pos += length;
+		}
+		else {
+			writeLiteral(writer, input[pos]);
+			pos++;
+		}
+	}
+}
+
+// Optimal parse for fixed size tokens: every distance costs the same,
+// so the longest match at each position covers every shorter length as well
+static int parseOptimal(MatchFinder *finder, LZSSWriter *writer) {
+	uint32_t size = finder->inputSize;
+	uint32_t *cost = malloc(((size_t)size + 1) * sizeof(uint32_t));
+	uint8_t *matchLength = malloc((size_t)size + 1);
+	uint16_t *matchDistance = malloc(((size_t)size + 1) * sizeof(uint16_t));
+	uint8_t *choice = malloc((size_t)size + 1);
+	if (cost == NULL || matchLength == NULL || matchDistance == NULL || choice == NULL) {
+		free(cost);
+		free(matchLength);
+		free(matchDistance);
+		free(choice);
+		return -1;
+	}
+
+	for (uint32_t pos = 0; pos < size; pos++) {
+		uint32_t distance = 0;
+		matchLength[pos] = (uint8_t)findMatch(finder, pos, &distance);
+		matchDistance[pos] = (uint16_t)distance;
+	}
+
+	// Cheapest way to encode everything from pos to the end
+	cost[size] = 0;
+	for (uint32_t pos = size; pos-- > 0;) {
+		cost[pos] = cost[pos + 1] + LITERAL_COST;
+		choice[pos] = 0;
+		for (uint32_t length = MIN_MATCH; length <= matchLength[pos]; length++) {
+			uint32_t referenceCost = cost[pos + length] + REFERENCE_COST;
+			if (referenceCost < cost[pos]) {
+				cost[pos] = referenceCost;
+				choice[pos] = (uint8_t)length;
+			}
+		}
+	}
+
+	uint32_t pos = 0;
+	while (pos < size) {
+		if (choice[pos] == 0) {
+			writeLiteral(writer, finder->input[pos]);
+			pos++;
+		}
+		else {
+			writeReference(writer, pos, matchDistance[pos], choice[pos]);
+			pos += choice[pos];
+		}
+	}
+
+	free(cost);
+	free(matchLength);
+	free(matchDistance);
+	free(choice);
+	return 0;
+}
+
+int lzssCompressSMB(const uint8_t *input, uint32_t inputSize, int level, uint8_t **output, uint32_t *outputSize) {
+	// Worst case is all literals, one control byte per 8 of them
+	uint32_t maxSize = SMB_LZ_HEADER_SIZE + inputSize + (inputSize + 7) / 8;
+	LZSSWriter writer;
+	writer.output = malloc(maxSize);
+	MatchFinder *finder = malloc(sizeof(MatchFinder));
+	if (writer.output == NULL || finder == NULL) {
+		free(writer.output);
+		free(finder);
+		return -1;
+	}
+	writer.outPos = SMB_LZ_HEADER_SIZE;
+	writer.controlPos = 0;
+	// Start "full" so the first token opens a control block
+	writer.controlBit = 8;
+
+	int result = 0;
+	switch (level) {
+	case LZSS_LEVEL_FAST:
+		initMatchFinder(finder, input, inputSize, 8);
+		parseGreedy(finder, &writer, 0);
+		break;
+	case LZSS_LEVEL_NORMAL:
+		initMatchFinder(finder, input, inputSize, 64);
+		parseGreedy(finder, &writer, 1);
+		break;
+	case LZSS_LEVEL_OPTIMAL:
+		initMatchFinder(finder, input, inputSize, LZSS_WINDOW_SIZE);
+		result = parseOptimal(finder, &writer);
+		break;
+	default:
+		result = -1;
+	}
+	free(finder);
+	if (result != 0) {
+		free(writer.output);
+		return -1;
+	}
+
+	writeLittleIntData(writer.output, 0, writer.outPos);
+	writeLittleIntData(writer.output, 4, inputSize);
+	*output = writer.output;
+	*outputSize = writer.outPos;
+	return 0;
+}
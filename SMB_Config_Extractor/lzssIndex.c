@@ -0,0 +1,257 @@
+#include "lzss.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FunctionsAndDefines.h"
+
+// Index file layout (little endian)
+// 0x00 "SLZI"
+// 0x04 Version
+// 0x08 Checkpoint interval
+// 0x0C Checkpoint count
+// 0x10 Compressed size from the lz header
+// 0x14 Decompressed size from the lz header
+// 0x18 FNV-1a hash of the whole lz file (8 bytes)
+// 0x20 Checkpoints: output position, input position, 4 KB window
+#define INDEX_MAGIC "SLZI"
+#define INDEX_VERSION 1
+#define INDEX_HEADER_SIZE 0x20
+
+int lzssBuildIndex(const uint8_t *lz, uint32_t lzSize, const uint8_t *decompressed, uint32_t interval, LZSSIndex *index) {
+	SMBLZHeader header;
+	if (interval == 0 || readSMBLZHeader(lz, lzSize, &header) != 0) {
+		return -1;
+	}
+	const uint8_t *input = lz + SMB_LZ_HEADER_SIZE;
+	uint32_t inputSize = header.compressedSize - SMB_LZ_HEADER_SIZE;
+	uint32_t outputSize = header.decompressedSize;
+
+	uint32_t maxCheckpoints = outputSize / interval + 1;
+	index->checkpoints = malloc(maxCheckpoints * sizeof(LZSSCheckpoint));
+	if (index->checkpoints == NULL) {
+		return -1;
+	}
+	index->interval = interval;
+	index->compressedSize = header.compressedSize;
+	index->decompressedSize = outputSize;
+	index->lzHash = hashFNV1a(lz, lzSize);
+	index->checkpointCount = 0;
+
+	// Walk the control blocks without decoding, only the positions matter here
+	uint32_t inPos = 0;
+	uint32_t outPos = 0;
+	uint32_t nextCheckpoint = 0;
+	while (inPos < inputSize && outPos < outputSize) {
+		if (outPos >= nextCheckpoint && index->checkpointCount < maxCheckpoints) {
+			index->checkpoints[index->checkpointCount].outPos = outPos;
+			index->checkpoints[index->checkpointCount].inPos = inPos;
+			index->checkpointCount++;
+			nextCheckpoint = (outPos / interval + 1) * interval;
+		}
+
+		uint8_t block = input[inPos++];
+		for (int j = 0; j < 8 && inPos < inputSize && outPos < outputSize; ++j) {
+			if (block & 0x01) {
+				inPos++;
+				outPos++;
+			}
+			else {
+				if (inPos + 2 > inputSize) {
+					inPos = inputSize;
+					break;
+				}
+				outPos += (input[inPos + 1] & 0x0F) + 3;
+				inPos += 2;
+			}
+			block = block >> 1;
+		}
+	}
+	if (outPos != outputSize) {
+		lzssFreeIndex(index);
+		return -1;
+	}
+
+	// Snapshot the window as the streaming decoder would hold it at each checkpoint
+	for (uint32_t i = 0; i < index->checkpointCount; ++i) {
+		LZSSCheckpoint *checkpoint = &index->checkpoints[i];
+		memset(checkpoint->window, 0, sizeof(checkpoint->window));
+		uint32_t start = checkpoint->outPos > LZSS_WINDOW_SIZE ? checkpoint->outPos - LZSS_WINDOW_SIZE : 0;
+		for (uint32_t pos = start; pos < checkpoint->outPos; ++pos) {
+			checkpoint->window[pos & (LZSS_WINDOW_SIZE - 1)] = decompressed[pos];
+		}
+	}
+	return 0;
+}
+
+int lzssWriteIndex(const char *filename, const LZSSIndex *index) {
+	FILE *output = fopen(filename, "wb");
+	if (output == NULL) {
+		return -1;
+	}
+
+	uint8_t header[INDEX_HEADER_SIZE];
+	memcpy(header, INDEX_MAGIC, 4);
+	writeLittleIntData(header, 0x04, INDEX_VERSION);
+	writeLittleIntData(header, 0x08, index->interval);
+	writeLittleIntData(header, 0x0C, index->checkpointCount);
+	writeLittleIntData(header, 0x10, index->compressedSize);
+	writeLittleIntData(header, 0x14, index->decompressedSize);
+	writeLittleIntData(header, 0x18, (uint32_t)index->lzHash);
+	writeLittleIntData(header, 0x1C, (uint32_t)(index->lzHash >> 32));
+	int result = fwrite(header, 1, sizeof(header), output) == sizeof(header) ? 0 : -1;
+
+	for (uint32_t i = 0; i < index->checkpointCount && result == 0; ++i) {
+		uint8_t positions[8];
+		writeLittleIntData(positions, 0, index->checkpoints[i].outPos);
+		writeLittleIntData(positions, 4, index->checkpoints[i].inPos);
+		if (fwrite(positions, 1, sizeof(positions), output) != sizeof(positions)
+			|| fwrite(index->checkpoints[i].window, 1, LZSS_WINDOW_SIZE, output) != LZSS_WINDOW_SIZE) {
+			result = -1;
+		}
+	}
+
+	fclose(output);
+	return result;
+}
+
+int lzssReadIndex(const char *filename, LZSSIndex *index) {
+	index->checkpoints = NULL;
+	index->checkpointCount = 0;
+	FILE *input = fopen(filename, "rb");
+	if (input == NULL) {
+		return -1;
+	}
+
+	uint8_t header[INDEX_HEADER_SIZE];
+	if (fread(header, 1, sizeof(header), input) != sizeof(header)
+		|| memcmp(header, INDEX_MAGIC, 4) != 0
+		|| readLittleIntData(header, 0x04) != INDEX_VERSION) {
+		fclose(input);
+		return -1;
+	}
+	index->interval = readLittleIntData(header, 0x08);
+	uint32_t count = readLittleIntData(header, 0x0C);
+	index->compressedSize = readLittleIntData(header, 0x10);
+	index->decompressedSize = readLittleIntData(header, 0x14);
+	index->lzHash = readLittleIntData(header, 0x18) | ((uint64_t)readLittleIntData(header, 0x1C) << 32);
+
+	// Every non empty stage has a checkpoint at the start, never more than one per interval
+	if (index->interval == 0 || index->compressedSize < SMB_LZ_HEADER_SIZE || count == 0 || count > index->decompressedSize / index->interval + 1) {
+		fclose(input);
+		return -1;
+	}
+	index->checkpoints = malloc(count * sizeof(LZSSCheckpoint));
+	if (index->checkpoints == NULL) {
+		fclose(input);
+		return -1;
+	}
+
+	for (uint32_t i = 0; i < count; ++i) {
+		uint8_t positions[8];
+		LZSSCheckpoint *checkpoint = &index->checkpoints[i];
+		if (fread(positions, 1, sizeof(positions), input) != sizeof(positions)
+			|| fread(checkpoint->window, 1, LZSS_WINDOW_SIZE, input) != LZSS_WINDOW_SIZE) {
+			break;
+		}
+		checkpoint->outPos = readLittleIntData(positions, 0);
+		checkpoint->inPos = readLittleIntData(positions, 4);
+
+		// Checkpoints have to start at zero and keep moving forward through both streams
+		if (i == 0 ? (checkpoint->outPos != 0 || checkpoint->inPos != 0)
+			: (checkpoint->outPos <= index->checkpoints[i - 1].outPos || checkpoint->inPos <= index->checkpoints[i - 1].inPos)) {
+			break;
+		}
+		if (checkpoint->outPos >= index->decompressedSize || checkpoint->inPos >= index->compressedSize - SMB_LZ_HEADER_SIZE) {
+			break;
+		}
+		index->checkpointCount++;
+	}
+	fclose(input);
+
+	if (index->checkpointCount != count) {
+		lzssFreeIndex(index);
+		return -1;
+	}
+	return 0;
+}
+
+void lzssFreeIndex(LZSSIndex *index) {
+	free(index->checkpoints);
+	index->checkpoints = NULL;
+	index->checkpointCount = 0;
+}
+
+int lzssIndexMatches(const LZSSIndex *index, const uint8_t *lz, uint32_t lzSize) {
+	SMBLZHeader header;
+	if (readSMBLZHeader(lz, lzSize, &header) != 0) {
+		return 0;
+	}
+	return header.compressedSize == index->compressedSize
+		&& header.decompressedSize == index->decompressedSize
+		&& hashFNV1a(lz, lzSize) == index->lzHash;
+}
+
+uint32_t lzssIndexFindChunk(const LZSSIndex *index, uint32_t pos) {
+	// Last checkpoint that starts at or before pos
+	uint32_t low = 0;
+	uint32_t high = index->checkpointCount;
+	while (high - low > 1) {
+		uint32_t middle = low + (high - low) / 2;
+		if (index->checkpoints[middle].outPos <= pos) {
+			low = middle;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+uint32_t lzssIndexChunkEnd(const LZSSIndex *index, uint32_t chunk) {
+	if (chunk + 1 < index->checkpointCount) {
+		return index->checkpoints[chunk + 1].outPos;
+	}
+	return index->decompressedSize;
+}
+
+typedef struct {
+	uint8_t *output;
+	uint32_t pos;
+	uint32_t end;
+}ChunkSink;
+
+static int writeChunkOutput(void *userData, const uint8_t *data, uint32_t size) {
+	ChunkSink *chunkSink = (ChunkSink *)userData;
+	if (size > chunkSink->end - chunkSink->pos) {
+		return -1;
+	}
+	memcpy(chunkSink->output + chunkSink->pos, data, size);
+	chunkSink->pos += size;
+	return 0;
+}
+
+int lzssDecodeChunk(const uint8_t *lz, uint32_t lzSize, const LZSSIndex *index, uint32_t chunk, uint8_t *output) {
+	if (chunk >= index->checkpointCount || lzSize < index->compressedSize) {
+		return -1;
+	}
+	const LZSSCheckpoint *checkpoint = &index->checkpoints[chunk];
+	const uint8_t *input = lz + SMB_LZ_HEADER_SIZE;
+	uint32_t inputSize = index->compressedSize - SMB_LZ_HEADER_SIZE;
+
+	// Checkpoints sit on control block boundaries, so decoding from one stops exactly on the next
+	ChunkSink chunkSink;
+	chunkSink.output = output;
+	chunkSink.pos = checkpoint->outPos;
+	chunkSink.end = lzssIndexChunkEnd(index, chunk);
+
+	LZSSStream stream;
+	lzssStreamResume(&stream, index->decompressedSize, checkpoint->outPos, checkpoint->window);
+	stream.stopPos = chunkSink.end;
+	if (lzssStreamFeed(&stream, input + checkpoint->inPos, inputSize - checkpoint->inPos, &writeChunkOutput, &chunkSink) != 0
+		|| lzssStreamFlush(&stream, &writeChunkOutput, &chunkSink) != 0) {
+		return -1;
+	}
+	return chunkSink.pos == chunkSink.end ? 0 : -1;
+}
@@ -2,12 +2,22 @@
 #define _CRT_SECURE_NO_WARNINGS
 #endif
 
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
 
 #include "FunctionsAndDefines.h"
 #include "configExtractor.h"
+#include "directoryScan.h"
+#include "extractCache.h"
+#include "itemArray.h"
+#include "lzss.h"
+#include "nameTable.h"
+#include "threadPool.h"
 
 typedef struct {
 	int number;
@@ -24,33 +34,121 @@ typedef struct {
 	float zRot;
 }AnimFrame;
 
-static float readRot(FILE* file) {
-	char rotStr[3];
-	fscanf(file, "%c%c", (rotStr + 1), (rotStr + 0));
-	float angle = (float)*((unsigned short*)rotStr);
-	angle = angle * 360.0f / 65536.0f;
-	return angle;
-}
+typedef enum { MODE_EXTRACT, MODE_COMPRESS, MODE_DECOMPRESS, MODE_INDEX, MODE_INFO } FileMode;
+
+// Messages about one file, printed straight away or held until the files before it have been printed
+typedef struct {
+	int buffered;
+	char *text;
+	size_t size;
+	size_t capacity;
+}FileLog;
+
+// One file argument and the flags that were set when it came up
+typedef struct {
+	const char *argument;
+	FileMode mode;
+	int legacyExtractor;
+	int writeRaw;
+	int writeCollision;
+	int writeStats;
+	int compressLevel;
+	ExtractCache *cache;    // NULL unless -cache was given
+	FileLog log;
+	int done;
+}FileJob;
+
+// Files that are worked on at the same time with -j
+typedef struct {
+	FileJob *jobs;
+	uint32_t count;
+	uint32_t printed;   // Logs are printed in argument order, this is the next one
+	ThreadPool *pool;
+	ThreadLock *lock;
+}FileBatch;
+
+// Files found under a directory argument, each one's log is printed once it's done
+typedef struct {
+	FileJob settings;
+	ThreadPool *pool;
+	ThreadLock *lock;
+}DirectoryJob;
+
+// Every header field the extractors read sits below this
+#define STAGE_HEADER_SIZE 0xC0
 
 #define NUM_SMB1_MARKERS 22
 #define NUM_SMB2_MARKERS 24
 #define NUM_SMBX_MARKERS 35
 
-static uint32_t SMB1Markers[NUM_SMB1_MARKERS] = { 0x00000064, 0x00000078, 0x0000000a, 0x0000000f, 0x00000005, 0x00000008, 0x0000000e, 0x00000019, 0x00000014, 0x0000001e, 0x0000003c, 0x0000001b, 0x00000002, 0x00000006, 0x00000004, 0x0000001f, 0x00000012, 0x0000001a, 0x00000028, 0x000001e0, 0x000000f0, 0x000000c8 };
-static uint32_t SMB2Markers[NUM_SMB2_MARKERS] = { 0x42c80000, 0x447a0000, 0x41f00000, 0x42700000, 0x41200000, 0x45bb8000, 0x453b8000, 0x438c0000, 0x43f00000, 0x42a00000, 0x42200000, 0x44fa0000, 0x41a00000, 0x44e10000, 0x40000000, 0x40400000, 0x43200000, 0x43520000, 0x42480000, 0x43700000, 0x44760000, 0x43dc0000, 0x442f0000, 0x43480000 };
-static uint32_t SMBXMarkers[NUM_SMBX_MARKERS] = { 0x0000c842, 0x00007a44, 0x0000f041, 0x00007042, 0x00002041, 0x0080bb45, 0x00803b45, 0x00008c43, 0x0000f043, 0x0000a042, 0x00002042, 0x00004843, 0x0000fa44, 0x0000a041, 0x0000e144, 0x00000040, 0x00004040, 0x00002043, 0x00005243, 0x00004842, 0x00007043, 0x00007644, 0x0000dc43, 0x00002f44, 0x0000c040, 0x0000f042, 0x0000a040, 0x00000041, 0x0000c841, 0x0000d841, 0x00008040, 0x0000f841, 0x00009041, 0x00000042, 0x00007041 };
+static const uint32_t SMB1Markers[NUM_SMB1_MARKERS] = { 0x00000064, 0x00000078, 0x0000000a, 0x0000000f, 0x00000005, 0x00000008, 0x0000000e, 0x00000019, 0x00000014, 0x0000001e, 0x0000003c, 0x0000001b, 0x00000002, 0x00000006, 0x00000004, 0x0000001f, 0x00000012, 0x0000001a, 0x00000028, 0x000001e0, 0x000000f0, 0x000000c8 };
+static const uint32_t SMB2Markers[NUM_SMB2_MARKERS] = { 0x42c80000, 0x447a0000, 0x41f00000, 0x42700000, 0x41200000, 0x45bb8000, 0x453b8000, 0x438c0000, 0x43f00000, 0x42a00000, 0x42200000, 0x44fa0000, 0x41a00000, 0x44e10000, 0x40000000, 0x40400000, 0x43200000, 0x43520000, 0x42480000, 0x43700000, 0x44760000, 0x43dc0000, 0x442f0000, 0x43480000 };
+static const uint32_t SMBXMarkers[NUM_SMBX_MARKERS] = { 0x0000c842, 0x00007a44, 0x0000f041, 0x00007042, 0x00002041, 0x0080bb45, 0x00803b45, 0x00008c43, 0x0000f043, 0x0000a042, 0x00002042, 0x00004843, 0x0000fa44, 0x0000a041, 0x0000e144, 0x00000040, 0x00004040, 0x00002043, 0x00005243, 0x00004842, 0x00007043, 0x00007644, 0x0000dc43, 0x00002f44, 0x0000c040, 0x0000f042, 0x0000a040, 0x00000041, 0x0000c841, 0x0000d841, 0x00008040, 0x0000f841, 0x00009041, 0x00000042, 0x00007041 };
+
+static int decompress(const char* filename, StageFile *stage, int writeStats, FileLog *log);
+static int compress(const char* filename, int level, FileLog *log);
+static int decompressToFile(const char* filename, FileLog *log);
+static int writeIndexFile(const char* filename, FileLog *log);
+static int probeFile(const char* filename, FileLog *log);
+static int determineGame(StageFile *stage);
+static int extractConfigOld(StageFile *lz, const char* filename, int game);
+
+static void logPrintf(FileLog *log, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	if (!log->buffered) {
+		vprintf(format, args);
+		va_end(args);
+		return;
+	}
 
-// File Reading Functions (Endianness handling)
-static uint32_t(*readInt)(FILE*);
-static uint32_t(*readIntRev)(FILE*);
-static uint16_t(*readShort)(FILE*);
-static uint16_t(*readShortRev)(FILE*);
-static float(*readFloat)(FILE*);
-static float(*readFloatRev)(FILE*);
+	va_list sizeArgs;
+	va_copy(sizeArgs, args);
+	int length = vsnprintf(NULL, 0, format, sizeArgs);
+	va_end(sizeArgs);
+	if (length > 0 && log->size + (size_t)length + 1 > log->capacity) {
+		size_t capacity = log->capacity < 256 ? 256 : log->capacity * 2;
+		while (capacity < log->size + (size_t)length + 1) {
+			capacity *= 2;
+		}
+		char *text = realloc(log->text, capacity);
+		if (text == NULL) {
+			va_end(args);
+			return;
+		}
+		log->text = text;
+		log->capacity = capacity;
+	}
+	if (length > 0) {
+		vsnprintf(log->text + log->size, log->capacity - log->size, format, args);
+		log->size += (size_t)length;
+	}
+	va_end(args);
+}
 
-static int decompress(const char* filename);
-static int determineGame(const char *filename);
-static void extractConfigOld(char* filename, int game);
+static void printLog(FileLog *log) {
+	if (log->size > 0) {
+		fwrite(log->text, 1, log->size, stdout);
+	}
+	free(log->text);
+	log->text = NULL;
+	log->size = 0;
+	log->capacity = 0;
+}
+
+// Reads a whitespace delimited string like fscanf's %s
+static void readString(StageFile *stage, char *buffer, int maxLength) {
+	int c = stageGetc(stage);
+	while (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f') {
+		c = stageGetc(stage);
+	}
+	int length = 0;
+	while (c != EOF && !(c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f') && length < maxLength) {
+		buffer[length++] = (char)c;
+		c = stageGetc(stage);
+	}
+	buffer[length] = '\0';
+}
 
 static int insert(AnimFrame frameTimes[], int count, float value) {
 
@@ -76,7 +174,8 @@ static int insert(AnimFrame frameTimes[], int count, float value) {
 }
 
 static void printHelp() {
-	puts("Usage: ./SMB_LZ_Tool [(FLAG | FILE)...]");
+	puts("Usage: ./SMB_LZ_Tool [(FLAG | FILE | DIRECTORY)...]");
+	puts("Directories are searched for lz files and raw stages, including every directory under them");
 	puts("Flags:");
 	puts("    -help      Show this help");
 	puts("    -h");
@@ -87,7 +186,263 @@ static void printHelp() {
 	puts("    -new       Use the new config extractor for xml style configs (default)");
 	puts("    -n");
 	puts("");
+	puts("    -raw       Also write the decompressed stage of lz files to <FILE>.raw");
+	puts("    -r");
+	puts("");
+	puts("    -collision Also write the collision triangles of each stage to <FILE>.ply (new extractor only)");
+	puts("");
+	puts("    -stats     Write decompression counters of lz files to <FILE>.stats.json");
+	puts("    -s");
+	puts("");
+	puts("    -compress  Compress the following files to <FILE>.lz instead of extracting configs");
+	puts("    -c");
+	puts("");
+	puts("    -decompress Only decompress the following lz files to <FILE>.raw (constant memory)");
+	puts("    -d");
+	puts("");
+	puts("    -index     Write a seek index <FILE>.idx for the following lz files instead of extracting configs");
+	puts("               Extracting from an lz file with an up to date index only decodes the parts that are read");
+	puts("    -i");
+	puts("");
+	puts("    -info      Print the game and a header summary of the following files instead of extracting configs");
+	puts("               Only the stage header of lz files is decompressed");
+	puts("    -p");
+	puts("");
+	puts("    -extract   Extract configs from the following files (default)");
+	puts("    -e");
+	puts("");
+	puts("    -level N   Compression level: 1 = fast (greedy), 2 = normal (lazy), 3 = optimal parse (default)");
+	puts("");
+	puts("    -cache FILE Skip extracting the following files if they haven't changed since they were last extracted");
+	puts("               with the same flags and their outputs are still there, FILE is the manifest that keeps track");
+	puts("");
+	puts("    -j N       Work on N of the following files at once (default 1)");
+	puts("               Messages are still printed in the order the files were given");
+	puts("               Directories are searched with N threads, or one per processor without -j");
+	puts("");
+
+}
+
+// Does whatever the flags asked for with one file argument
+static void processFile(FileJob *job, ThreadPool *pool) {
+	FileLog *log = &job->log;
+	// Every mode names its outputs after the input
+	if (strlen(job->argument) > MAX_INPUT_NAME_LENGTH) {
+		logPrintf(log, "Filename too long: %s\n", job->argument);
+		return;
+	}
+	if (job->mode == MODE_COMPRESS) {
+		compress(job->argument, job->compressLevel, log);
+		return;
+	}
+	else if (job->mode == MODE_DECOMPRESS) {
+		decompressToFile(job->argument, log);
+		return;
+	}
+	else if (job->mode == MODE_INDEX) {
+		writeIndexFile(job->argument, log);
+		return;
+	}
+	else if (job->mode == MODE_INFO) {
+		probeFile(job->argument, log);
+		return;
+	}
+
+	char filename[OUTPUT_NAME_SIZE];
+	int decomp = 0;
+	int filelength = (int) strlen(job->argument);
+	if (filelength < 4) {
+		logPrintf(log, "Filename too short: %s\n", job->argument);
+		return;
+	}
+	memcpy(filename, job->argument, (size_t)filelength + 1);
+
+	// Inputs with the same bytes as last time are skipped if their outputs are still there
+	// (statistics are about decoding, so they always decode)
+	int useCache = job->cache != NULL && !job->writeStats;
+	uint32_t cacheFlags = (job->legacyExtractor ? 0x1 : 0) | (job->writeRaw ? 0x2 : 0) | (job->writeCollision ? 0x4 : 0);
+	uint64_t hash = 0;
+	if (useCache) {
+		StageFile input;
+		if (mapStageFile(filename, &input) == 0) {
+			hash = hashFNV1a(input.data, input.size);
+			freeStageFile(&input);
+			if (isExtractionCached(job->cache, job->argument, hash, cacheFlags)) {
+				logPrintf(log, "Unchanged, skipping %s\n", filename);
+				return;
+			}
+		}
+		else {
+			useCache = 0;
+		}
+	}
+
+	// If lz file
+	if (filename[filelength - 2] == 'l' && filename[filelength - 1] == 'z') {
+		logPrintf(log, "Decompressing\n");
+		decomp = 1;
+	}// If not raw file
+	else if (!(filename[filelength - 2] == 'l' && filename[filelength - 1] == 'z' && filename[filelength - 1] == 'z')) {
+		// TODO If wanted
+		//printf("Warning, this may not be a raw LZ file. Please make sure you didn't drop the wrong file.");
+		//printf("File in Question: %s\n", argv[i]);
+		//continue;
+	}
+
+	// The stage stays in memory for detection and extraction
+	StageFile stage;
+	if (decomp) {
+		if (decompress(filename, &stage, job->writeStats, log) != 0) {
+			logPrintf(log, "Failed to decompress %s\nSkipping\n", filename);
+			return;
+		}
+		// Outputs are still named after the decompressed file
+		filename[filelength++] = '.';
+		filename[filelength++] = 'r';
+		filename[filelength++] = 'a';
+		filename[filelength++] = 'w';
+		filename[filelength++] = '\0';
+		if (job->writeRaw && writeStageFile(filename, &stage) != 0) {
+			logPrintf(log, "ERROR: Couldn't create %s\n", filename);
+		}
+	}
+	else if (mapStageFile(filename, &stage) != 0) {
+		logPrintf(log, "ERROR: %s not found\n", filename);
+		return;
+	}
+
+	int game = determineGame(&stage);
+	if (game == -1) {
+		logPrintf(log, "Unknown Game Marker for '%s'.\nContact Bobjrsenior", filename);
+		freeStageFile(&stage);
+		return;
+	}
+	int result;
+	int legacy = game == SMB1 || job->legacyExtractor;
+	if (legacy) {
+		result = extractConfigOld(&stage, filename, game);
+	}
+	else {
+		result = extractConfig(&stage, filename, game, pool, job->writeCollision);
+	}
+	freeStageFile(&stage);
+
+	if (useCache && result == 0) {
+		char configName[OUTPUT_NAME_SIZE];
+		char collisionName[OUTPUT_NAME_SIZE];
+		makeOutputName(configName, sizeof(configName), filename, legacy ? ".txt" : ".xml");
+		makeOutputName(collisionName, sizeof(collisionName), filename, ".ply");
+		const char *outputs[3] = { configName };
+		int outputCount = 1;
+		if (decomp && job->writeRaw) {
+			outputs[outputCount++] = filename;
+		}
+		if (!legacy && job->writeCollision) {
+			outputs[outputCount++] = collisionName;
+		}
+		recordExtraction(job->cache, job->argument, hash, cacheFlags, outputs, outputCount);
+	}
+}
+
+static void processFileTask(void *context, uint32_t index) {
+	FileBatch *batch = context;
+	processFile(&batch->jobs[index], batch->pool);
+
+	// Whoever finishes the next file in order prints it and any finished ones after it
+	if (batch->lock != NULL) {
+		acquireThreadLock(batch->lock);
+	}
+	batch->jobs[index].done = 1;
+	while (batch->printed < batch->count && batch->jobs[batch->printed].done) {
+		printLog(&batch->jobs[batch->printed++].log);
+	}
+	if (batch->lock != NULL) {
+		releaseThreadLock(batch->lock);
+	}
+}
+
+// Works on threadCount files at a time, threads without a file of their own help split up the collision fields of the others
+static void processFiles(FileJob *jobs, uint32_t count, int threadCount) {
+	if (count == 0) {
+		return;
+	}
+	FileBatch batch;
+	batch.jobs = jobs;
+	batch.count = count;
+	batch.printed = 0;
+	batch.pool = createThreadPool(threadCount);
+	batch.lock = batch.pool != NULL ? createThreadLock() : NULL;
+	if (batch.lock == NULL) {
+		destroyThreadPool(batch.pool);
+		batch.pool = NULL;
+	}
+	runThreadPool(batch.pool, count, &processFileTask, &batch);
+	destroyThreadLock(batch.lock);
+	destroyThreadPool(batch.pool);
+}
+
+// Directories hold configs and other outputs as well, only lz files and raw stages the mode works with are picked
+static int isStageFile(const char *path, FileMode mode) {
+	size_t length = strlen(path);
+	int lz = length >= 3 && strcmp(path + length - 3, ".lz") == 0;
+	if (mode == MODE_DECOMPRESS || mode == MODE_INDEX) {
+		return lz;
+	}
+	if (lz) {
+		return mode != MODE_COMPRESS;
+	}
+	// Raw files written next to lz files would only repeat them
+	if (length >= 7 && strcmp(path + length - 7, ".lz.raw") == 0) {
+		return 0;
+	}
+
+	// Raw stages are recognized by the same marker as when extracting
+	uint8_t header[0x8];
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return 0;
+	}
+	uint32_t headerSize = (uint32_t)fread(header, 1, sizeof(header), file);
+	fclose(file);
+	StageFile stage;
+	initStageFile(&stage, header, headerSize);
+	return determineGame(&stage) != -1;
+}
+
+static void processFoundFile(void *context, const char *path) {
+	DirectoryJob *directory = context;
+	if (!isStageFile(path, directory->settings.mode)) {
+		return;
+	}
+	FileJob job = directory->settings;
+	job.argument = path;
+	job.log.buffered = 1;
+	processFile(&job, directory->pool);
+
+	if (directory->lock != NULL) {
+		acquireThreadLock(directory->lock);
+	}
+	printLog(&job.log);
+	if (directory->lock != NULL) {
+		releaseThreadLock(directory->lock);
+	}
+}
 
+static void processDirectory(const char *path, const FileJob *settings, int threadCount) {
+	DirectoryJob directory;
+	directory.settings = *settings;
+	directory.pool = createThreadPool(threadCount);
+	directory.lock = directory.pool != NULL ? createThreadLock() : NULL;
+	if (directory.lock == NULL) {
+		destroyThreadPool(directory.pool);
+		directory.pool = NULL;
+	}
+	uint32_t failed = scanDirectory(path, directory.pool, threadCount, &processFoundFile, &directory);
+	if (failed > 0) {
+		printf("ERROR: Couldn't read %" PRIu32 " director%s in %s\n", failed, failed == 1 ? "y" : "ies", path);
+	}
+	destroyThreadLock(directory.lock);
+	destroyThreadPool(directory.pool);
 }
 
 int main(int argc, char* argv[]) {
@@ -96,6 +451,19 @@ int main(int argc, char* argv[]) {
 	}
 
 	int legacyExtractor = 0;
+	int writeRaw = 0;
+	int writeCollision = 0;
+	int writeStats = 0;
+	FileMode mode = MODE_EXTRACT;
+	int compressLevel = LZSS_LEVEL_OPTIMAL;
+	// Files at once, above 1 they're held in jobs until the flags change or the arguments run out
+	// 0 until -j is given, directories use every processor then
+	int jobCount = 0;
+	FileJob *jobs = NULL;
+	uint32_t batchCount = 0;
+	// Collision fields of each stage are split between these threads
+	ThreadPool *pool = NULL;
+	ExtractCache *cache = NULL;
 
 	for (int i = 1; i < argc; ++i) {
 		// Check for Command Line flags
@@ -107,70 +475,142 @@ int main(int argc, char* argv[]) {
 			legacyExtractor = 0;
 			continue;
 		}
-		else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-help") == 0) {
-			printHelp();
+		else if (strcmp(argv[i], "-raw") == 0 || strcmp(argv[i], "-r") == 0) {
+			writeRaw = 1;
 			continue;
 		}
-
-		char filename[512];
-		int decomp = 0;
-		int filelength = (int) strlen(argv[i]);
-		if (filelength < 4) {
-			printf("Filename too short: %s\n", argv[i]);
+		else if (strcmp(argv[i], "-collision") == 0) {
+			writeCollision = 1;
+			continue;
+		}
+		else if (strcmp(argv[i], "-stats") == 0 || strcmp(argv[i], "-s") == 0) {
+			writeStats = 1;
+			continue;
+		}
+		else if (strcmp(argv[i], "-compress") == 0 || strcmp(argv[i], "-c") == 0) {
+			mode = MODE_COMPRESS;
+			continue;
+		}
+		else if (strcmp(argv[i], "-decompress") == 0 || strcmp(argv[i], "-d") == 0) {
+			mode = MODE_DECOMPRESS;
+			continue;
+		}
+		else if (strcmp(argv[i], "-index") == 0 || strcmp(argv[i], "-i") == 0) {
+			mode = MODE_INDEX;
+			continue;
+		}
+		else if (strcmp(argv[i], "-info") == 0 || strcmp(argv[i], "-p") == 0) {
+			mode = MODE_INFO;
+			continue;
+		}
+		else if (strcmp(argv[i], "-extract") == 0 || strcmp(argv[i], "-e") == 0) {
+			mode = MODE_EXTRACT;
+			continue;
+		}
+		else if (strcmp(argv[i], "-level") == 0) {
+			if (i + 1 >= argc || sscanf(argv[i + 1], "%d", &compressLevel) != 1 || compressLevel < LZSS_LEVEL_FAST || compressLevel > LZSS_LEVEL_OPTIMAL) {
+				printf("-level needs a compression level from %d to %d\n", LZSS_LEVEL_FAST, LZSS_LEVEL_OPTIMAL);
+				compressLevel = LZSS_LEVEL_OPTIMAL;
+			}
+			++i;
 			continue;
 		}
-		sscanf(argv[i], "%507s", filename);
-		// If lz file
-		if (filename[filelength - 2] == 'l' && filename[filelength - 1] == 'z') {
-			printf("Decompressing\n");
-			decomp = 1;
-		}// If not raw file
-		else if (!(filename[filelength - 2] == 'l' && filename[filelength - 1] == 'z' && filename[filelength - 1] == 'z')) {
-			// TODO If wanted
-			//printf("Warning, this may not be a raw LZ file. Please make sure you didn't drop the wrong file.");
-			//printf("File in Question: %s\n", argv[i]);
-			//continue;
-		}
-
-		if (decomp) {
-			if (decompress(filename) == 0) {
-				filename[filelength++] = '.';
-				filename[filelength++] = 'r';
-				filename[filelength++] = 'a';
-				filename[filelength++] = 'w';
-				filename[filelength++] = '\0';
+		else if (strcmp(argv[i], "-cache") == 0) {
+			// Queued files still use the cache they were given with
+			processFiles(jobs, batchCount, jobCount);
+			batchCount = 0;
+			if (closeExtractCache(cache) != 0) {
+				printf("ERROR: Couldn't write the cache manifest\n");
+			}
+			cache = NULL;
+			if (i + 1 >= argc) {
+				printf("-cache needs a manifest file name\n");
 			}
-			else {
-				printf("Failed to decompress %s\nSkipping\n", filename);
+			else if ((cache = openExtractCache(argv[i + 1])) == NULL) {
+				printf("ERROR: Out of memory, not using %s\n", argv[i + 1]);
 			}
+			++i;
+			continue;
 		}
-		int game = determineGame(filename);
-		if (game == -1) {
-			printf("Unknown Game Marker for '%s'.\nContact Bobjrsenior", filename);
+		else if (strcmp(argv[i], "-j") == 0) {
+			// Files before this keep the old count
+			processFiles(jobs, batchCount, jobCount);
+			batchCount = 0;
+			if (i + 1 >= argc || sscanf(argv[i + 1], "%d", &jobCount) != 1 || jobCount < 1) {
+				printf("-j needs a number of files to work on at once\n");
+				jobCount = 0;
+			}
+			++i;
 			continue;
 		}
-		if (game == SMB1 || legacyExtractor) {
-			extractConfigOld(filename, game);
+		else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-help") == 0) {
+			processFiles(jobs, batchCount, jobCount);
+			batchCount = 0;
+			printHelp();
+			continue;
 		}
-		else {
-			extractConfig(filename, game);
+
+		FileJob job;
+		job.argument = argv[i];
+		job.mode = mode;
+		job.legacyExtractor = legacyExtractor;
+		job.writeRaw = writeRaw;
+		job.writeCollision = writeCollision;
+		job.writeStats = writeStats;
+		job.compressLevel = compressLevel;
+		job.cache = cache;
+		job.log.buffered = jobCount > 1;
+		job.log.text = NULL;
+		job.log.size = 0;
+		job.log.capacity = 0;
+		job.done = 0;
+
+		if (isDirectory(argv[i])) {
+			// Everything given before the directory is printed first
+			processFiles(jobs, batchCount, jobCount);
+			batchCount = 0;
+			processDirectory(argv[i], &job, jobCount > 0 ? jobCount : getProcessorCount());
+			continue;
 		}
-	}
 
+		if (jobCount > 1) {
+			// Room for every file argument is made the first time
+			if (jobs == NULL) {
+				jobs = malloc(sizeof(FileJob) * (size_t)argc);
+				if (jobs == NULL) {
+					printf("ERROR: Out of memory, working on one file at a time\n");
+					jobCount = 1;
+					job.log.buffered = 0;
+				}
+			}
+			if (jobs != NULL) {
+				jobs[batchCount++] = job;
+				continue;
+			}
+		}
 
+		if (mode == MODE_EXTRACT && !legacyExtractor && pool == NULL) {
+			pool = createThreadPool(getProcessorCount());
+		}
+		processFile(&job, pool);
+	}
+	processFiles(jobs, batchCount, jobCount);
+
+	free(jobs);
+	if (closeExtractCache(cache) != 0) {
+		printf("ERROR: Couldn't write the cache manifest\n");
+	}
+	destroyThreadPool(pool);
 
 	return 0;
 }
 
-static int determineGame(const char *filename) {
-	FILE *input = fopen(filename, "rb");
-	if (input == NULL) {
-		perror("Failed to check game version");
+static int determineGame(StageFile *stage) {
+	if (stage->size < 0x8) {
 		return -1;
 	}
-	fseek(input, 0x4, SEEK_SET);
-	uint32_t gameCheck = readBigInt(input);
-	fclose(input);
+	stageSeek(stage, 0x4, SEEK_SET);
+	uint32_t gameCheck = readBigInt(stage);
 
 	// Check SMB 1
 	for (int i = 0; i < NUM_SMB1_MARKERS; i++) {
@@ -196,767 +636,446 @@ static int determineGame(const char *filename) {
 	return -1;
 }
 
-static void extractConfigOld(char* filename, int game) {
-	FILE* lz = fopen(filename, "rb");
-	if (lz == NULL) {
-		printf("ERROR: %s not found\n", filename);
-		return;
+// Longest name the legacy extractor keeps
+#define LEGACY_NAME_LENGTH 511
+
+// Reads the model name at offset like fscanf's %s, cut off after maxLength characters
+// Each offset is only read once per stage, the stage position is left wherever it ends up
+static void readLegacyName(StageFile *stage, NameTable *names, int offset, char *buffer, int maxLength) {
+	const char *name = names != NULL ? findName(names, (uint32_t)offset) : NULL;
+	if (name == NULL) {
+		// A bad offset reads from wherever the stage already is, so that isn't kept
+		if (stageSeek(stage, offset, SEEK_SET) != 0) {
+			readString(stage, buffer, maxLength);
+			return;
+		}
+		readString(stage, buffer, LEGACY_NAME_LENGTH);
+		name = names != NULL ? addName(names, (uint32_t)offset, buffer, (uint32_t)strlen(buffer)) : NULL;
+		if (name == NULL) {
+			buffer[maxLength] = '\0';
+			return;
+		}
 	}
+	size_t length = strlen(name);
+	if (length > (size_t)maxLength) {
+		length = (size_t)maxLength;
+	}
+	memcpy(buffer, name, length);
+	buffer[length] = '\0';
+}
 
-	ConfigObjectOld collisionFields;
-	ConfigObjectOld startPositions;
-	ConfigObjectOld falloutY;
-	ConfigObjectOld goals;
-	ConfigObjectOld bumpers;
-	ConfigObjectOld jamabars;
-	ConfigObjectOld bananas;
-	ConfigObjectOld backgrounds;
-
-	// Init read functions (SMB1/2 is big endian, SMBX is little endian)
-	if (game == SMB1 || game == SMB2) {
-		readInt = &readBigInt;
-		readIntRev = &readLittleInt;
-		readShort = &readBigShort;
-		readShortRev = &readLittleShort;
-		readFloat = &readBigFloat;
-		readFloatRev = &readLittleFloat;
+// Rotation triples sit after the position in every legacy item that has one
+#define LEGACY_ROTATION_OFFSET 0xC
+
+// Decodes the rotation triples of a whole item list to degrees, read them back with itemF32 (fields 0-2 are x, y, z)
+// Only items already in memory in full are decoded, the rest are left to readRot so reads past the end come out as before
+static void decodeLegacyRotations(StageFile *stage, ConfigObjectOld items, uint32_t stride, int bigEndian, ItemArray *rotations) {
+	static const uint16_t fields[3] = {
+		ITEM_SHORT(LEGACY_ROTATION_OFFSET), ITEM_SHORT(LEGACY_ROTATION_OFFSET + 2), ITEM_SHORT(LEGACY_ROTATION_OFFSET + 4) };
+	rotations->count = 0;
+	rotations->fieldCount = 3;
+	rotations->columns = NULL;
+	if (items.number <= 0 || items.offset < 0) {
+		return;
 	}
-	else if (game == SMBX) {
-		readInt = &readLittleInt;
-		readIntRev = &readBigInt;
-		readShort = &readLittleShort;
-		readShortRev = &readBigShort;
-		readFloat = &readLittleFloat;
-		readFloat = &readBigFloat;
+	uint64_t size = (uint64_t)items.number * stride;
+	uint32_t count = stageResidentSpan(stage, (uint32_t)items.offset, size > UINT32_MAX ? UINT32_MAX : (uint32_t)size) / stride;
+	// Left empty if there's no memory for it, every item is read with readRot then
+	if (count == 0 || decodeItemArray(rotations, stage->data + items.offset, count, stride, fields, 3, bigEndian) != 0) {
+		return;
 	}
+	convertItemRotations(rotations, 0, 3);
+}
 
-
-	fseek(lz, 8, SEEK_SET);
-
-	if (game == SMB1) {
-		collisionFields.number = readInt(lz);
-		collisionFields.offset = readInt(lz);
+// Big endian (SMB1/SMB2)
+#define ENDIAN_SUFFIX Big
+#define readInt readBigInt
+#define readShort readBigShort
+#define readFloat readBigFloat
+#define readRot(file) convertRotation(readBigShort(file))
+#define STAGE_BIG_ENDIAN 1
+#include "legacyExtractorImpl.h"
+#undef ENDIAN_SUFFIX
+#undef readInt
+#undef readShort
+#undef readFloat
+#undef readRot
+#undef STAGE_BIG_ENDIAN
+
+// Little endian (SMBX)
+#define ENDIAN_SUFFIX Little
+#define readInt readLittleInt
+#define readShort readLittleShort
+#define readFloat readLittleFloat
+#define readRot(file) convertRotation(readLittleShort(file))
+#define STAGE_BIG_ENDIAN 0
+#include "legacyExtractorImpl.h"
+#undef ENDIAN_SUFFIX
+#undef readInt
+#undef readShort
+#undef readFloat
+#undef readRot
+#undef STAGE_BIG_ENDIAN
+
+// Returns -1 if the config couldn't be written
+static int extractConfigOld(StageFile *lz, const char* filename, int game) {
+	// Names are read straight from the stage if there's no memory for the table
+	NameTable *names = createNameTable(0);
+	int result;
+	// SMB1/2 is big endian, SMBX is little endian
+	if (game == SMBX) {
+		result = extractConfigOldLittle(lz, filename, game, names);
 	}
 	else {
-		fseek(lz, 8, SEEK_CUR);
+		result = extractConfigOldBig(lz, filename, game, names);
 	}
-	startPositions.offset = readInt(lz);
-
-	falloutY.number = 1;
-	falloutY.offset = readInt(lz);
+	destroyNameTable(names);
+	return result;
+}
 
-	startPositions.number = (falloutY.offset - startPositions.offset) / 0x14;
+static double wallSeconds() {
+	struct timespec now;
+	timespec_get(&now, TIME_UTC);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
 
-	goals.number = readInt(lz);
-	goals.offset = readInt(lz);
+static void writeJsonArray(FILE *output, const char *name, const uint32_t *values, int count) {
+	fprintf(output, "  \"%s\": [", name);
+	for (int i = 0; i < count; ++i) {
+		fprintf(output, i == 0 ? "%" PRIu32 : ", %" PRIu32, values[i]);
+	}
+	fprintf(output, "]");
+}
 
-	if (game == SMB1) {
-		fseek(lz, 8, SEEK_CUR);
+static int writeStatsFile(const char* filename, const LZSSStats *stats, double seconds, FileLog *log) {
+	char outfileName[OUTPUT_NAME_SIZE];
+	FILE *output = NULL;
+	if (makeOutputName(outfileName, sizeof(outfileName), filename, ".stats.json") == 0) {
+		output = fopen(outfileName, "w");
+	}
+	if (output == NULL) {
+		logPrintf(log, "ERROR: Couldn't create %s\n", outfileName);
+		return -1;
 	}
 
-	bumpers.number = readInt(lz);
-	bumpers.offset = readInt(lz);
+	// Windows paths need their backslashes escaped
+	fprintf(output, "{\n  \"file\": \"");
+	for (const char *c = filename; *c != '\0'; ++c) {
+		if (*c == '\\' || *c == '"') {
+			putc('\\', output);
+		}
+		putc(*c, output);
+	}
+	fprintf(output, "\",\n");
+	fprintf(output, "  \"bytesIn\": %" PRIu32 ",\n", stats->bytesIn);
+	fprintf(output, "  \"bytesOut\": %" PRIu32 ",\n", stats->bytesOut);
+	fprintf(output, "  \"literals\": %" PRIu32 ",\n", stats->literals);
+	fprintf(output, "  \"references\": %" PRIu32 ",\n", stats->references);
+	fprintf(output, "  \"zeroFillReferences\": %" PRIu32 ",\n", stats->zeroFillReferences);
+	fprintf(output, "  \"seconds\": %.9f,\n", seconds);
+	// Index 0 is a length of 3
+	writeJsonArray(output, "lengthHistogram", stats->lengthHistogram, LZSS_LENGTH_BUCKETS);
+	fprintf(output, ",\n");
+	// Index n counts distances from 2^n up to 2^(n + 1) - 1
+	writeJsonArray(output, "distanceHistogram", stats->distanceHistogram, LZSS_DISTANCE_BUCKETS);
+	fprintf(output, "\n}\n");
+	fclose(output);
+	return 0;
+}
 
-	jamabars.number = readInt(lz);
-	jamabars.offset = readInt(lz);
+int decompress(const char* filename, StageFile *stage, int writeStats, FileLog *log) {
+	// Read the whole lz file once and decode straight from it
+	StageFile lz;
+	if (mapStageFile(filename, &lz) != 0) {
+		logPrintf(log, "ERROR: File not found: %s\n", filename);
+		return -1;
+	}
+	logPrintf(log, "Decompressing %s\n", filename);
 
-	bananas.number = readInt(lz);
-	bananas.offset = readInt(lz);
+	SMBLZHeader header;
+	if (readSMBLZHeader(lz.data, lz.size, &header) != 0) {
+		freeStageFile(&lz);
+		logPrintf(log, "ERROR: Corrupt header in %s\n", filename);
+		return -1;
+	}
+	uint32_t dataSize = header.compressedSize - SMB_LZ_HEADER_SIZE;
+	uint32_t usize = header.decompressedSize;
+	logPrintf(log, "FILESIZE: %d\n", dataSize + 4);
+
+	// With an up to date seek index only the parts the extractor reads get decoded
+	char indexName[OUTPUT_NAME_SIZE];
+	int haveIndexName = makeOutputName(indexName, sizeof(indexName), filename, ".idx") == 0;
+	// (statistics need the whole stream decoded, so they skip the index)
+	LZSSIndex index;
+	if (!writeStats && haveIndexName && lzssReadIndex(indexName, &index) == 0) {
+		if (openIndexedStageFile(stage, &lz, &index) == 0) {
+			logPrintf(log, "Using seek index %s\n", indexName);
+			return 0;
+		}
+		lzssFreeIndex(&index);
+		logPrintf(log, "Ignoring out of date seek index %s\n", indexName);
+	}
 
-	if (game == SMB1) {
-		fseek(lz, 104, SEEK_SET);
+	// Decode entirely in memory into a buffer of exactly the size in the header
+	// (always allocate at least one byte so an empty stage still has a valid buffer)
+	uint8_t *decompressed = malloc(usize > 0 ? usize : 1);
+	if (decompressed == NULL) {
+		freeStageFile(&lz);
+		return -1;
+	}
+	int result;
+	if (writeStats) {
+		LZSSStats stats;
+		double startTime = wallSeconds();
+		result = lzssDecodeStats(lz.data + SMB_LZ_HEADER_SIZE, dataSize, decompressed, usize, &stats);
+		double seconds = wallSeconds() - startTime;
+		writeStatsFile(filename, &stats, seconds, log);
 	}
 	else {
-		fseek(lz, 88, SEEK_SET);
+		result = lzssDecode(lz.data + SMB_LZ_HEADER_SIZE, dataSize, decompressed, usize);
+	}
+	freeStageFile(&lz);
+	if (result != 0) {
+		free(decompressed);
+		logPrintf(log, "ERROR: Failed to decompress %s (data doesn't match the %" PRIu32 " byte size in the header)\n", filename, usize);
+		return -1;
 	}
 
-	backgrounds.number = readInt(lz);
-	backgrounds.offset = readInt(lz);
-
-	char outfileName[512];
-	sscanf(filename, "%507s", outfileName);
-	int fileLength = (int)strlen(outfileName);
-	outfileName[fileLength++] = '.';
-	outfileName[fileLength++] = 't';
-	outfileName[fileLength++] = 'x';
-	outfileName[fileLength++] = 't';
-	outfileName[fileLength++] = '\0';
-
-	FILE* outfile = fopen(outfileName, "w");
-
-	fseek(lz, falloutY.offset, SEEK_SET);
-
-	float falloutYYPos = readBigFloat(lz);
-	fprintf(outfile, "fallout [ 0 ] . pos . y = %f\n", falloutYYPos);
-
-	fprintf(outfile, "\n");
-
-	fseek(lz, startPositions.offset, SEEK_SET);
-
-	for (int j = 0; j < startPositions.number; ++j) {
-		float xPos = readBigFloat(lz);
-		float yPos = readBigFloat(lz);
-		float zPos = readBigFloat(lz);
-
-		float xRot = readRot(lz);
-		float yRot = readRot(lz);
-		float zRot = readRot(lz);
-
-		fseek(lz, 2, SEEK_CUR);
-
-		fprintf(outfile, "start [ %d ] . pos . x = %f\n", j, xPos);
-		fprintf(outfile, "start [ %d ] . pos . y = %f\n", j, yPos);
-		fprintf(outfile, "start [ %d ] . pos . z = %f\n", j, zPos);
+	initStageFile(stage, decompressed, usize);
 
-		fprintf(outfile, "start [ %d ] . rot . x = %f\n", j, xRot);
-		fprintf(outfile, "start [ %d ] . rot . y = %f\n", j, yRot);
-		fprintf(outfile, "start [ %d ] . rot . z = %f\n", j, zRot);
+	logPrintf(log, "Finished Decompressing %s\n", filename);
+	return 0;
+}
 
-		fprintf(outfile, "\n");
+static int compress(const char* filename, int level, FileLog *log) {
+	StageFile input;
+	if (mapStageFile(filename, &input) != 0) {
+		logPrintf(log, "ERROR: File not found: %s\n", filename);
+		return -1;
 	}
+	logPrintf(log, "Compressing %s\n", filename);
 
-	fseek(lz, goals.offset, SEEK_SET);
-
-	for (int j = 0; j < goals.number; ++j) {
-		float xPos = readBigFloat(lz);
-		float yPos = readBigFloat(lz);
-		float zPos = readBigFloat(lz);
-
-		float xRot = readRot(lz);
-		float yRot = readRot(lz);
-		float zRot = readRot(lz);
+	uint8_t *lz;
+	uint32_t lzSize;
+	if (lzssCompressSMB(input.data, input.size, level, &lz, &lzSize) != 0) {
+		freeStageFile(&input);
+		logPrintf(log, "ERROR: Failed to compress %s\n", filename);
+		return -1;
+	}
 
-		uint16_t shortType = readShort(lz);
-		char type = 'B';
-		if (game == SMB1) {
-			if (shortType == 0x4200) {
-				type = 'B';
-			}
-			else if (shortType == 0x4700) {
-				type = 'G';
-			}
-			else if (shortType == 0x5200) {
-				type = 'R';
-			}
+	// Round trip through the decoder before writing anything
+	int roundTrip = -1;
+	SMBLZHeader header;
+	uint8_t *check = malloc(input.size > 0 ? input.size : 1);
+	if (check != NULL && readSMBLZHeader(lz, lzSize, &header) == 0 && header.decompressedSize == input.size) {
+		if (lzssDecode(lz + SMB_LZ_HEADER_SIZE, header.compressedSize - SMB_LZ_HEADER_SIZE, check, input.size) == 0 && memcmp(check, input.data, input.size) == 0) {
+			roundTrip = 0;
 		}
-		else {
-			if (shortType == 0x0001) {
-				type = 'B';
-			}
-			else if (shortType == 0x0101) {
-				type = 'G';
-			}
-			else if (shortType == 0x0201) {
-				type = 'R';
-			}
-		}
-
-		fprintf(outfile, "goal [ %d ] . pos . x = %f\n", j, xPos);
-		fprintf(outfile, "goal [ %d ] . pos . y = %f\n", j, yPos);
-		fprintf(outfile, "goal [ %d ] . pos . z = %f\n", j, zPos);
-
-		fprintf(outfile, "goal [ %d ] . rot . x = %f\n", j, xRot);
-		fprintf(outfile, "goal [ %d ] . rot . y = %f\n", j, yRot);
-		fprintf(outfile, "goal [ %d ] . rot . z = %f\n", j, zRot);
-
-		fprintf(outfile, "goal [ %d ] . type . x = %c\n", j, type);
-
-		fprintf(outfile, "\n");
 	}
-
-	fseek(lz, bumpers.offset, SEEK_SET);
-
-	for (int j = 0; j < bumpers.number; ++j) {
-		float xPos = readBigFloat(lz);
-		float yPos = readBigFloat(lz);
-		float zPos = readBigFloat(lz);
-
-		float xRot = readRot(lz);
-		float yRot = readRot(lz);
-		float zRot = readRot(lz);
-
-		fseek(lz, 2, SEEK_CUR);
-
-		float xScl = readBigFloat(lz);
-		float yScl = readBigFloat(lz);
-		float zScl = readBigFloat(lz);
-
-		fprintf(outfile, "bumper [ %d ] . pos . x = %f\n", j, xPos);
-		fprintf(outfile, "bumper [ %d ] . pos . y = %f\n", j, yPos);
-		fprintf(outfile, "bumper [ %d ] . pos . z = %f\n", j, zPos);
-
-		fprintf(outfile, "bumper [ %d ] . rot . x = %f\n", j, xRot);
-		fprintf(outfile, "bumper [ %d ] . rot . y = %f\n", j, yRot);
-		fprintf(outfile, "bumper [ %d ] . rot . z = %f\n", j, zRot);
-
-		fprintf(outfile, "bumper [ %d ] . scl . x = %f\n", j, xScl);
-		fprintf(outfile, "bumper [ %d ] . scl . y = %f\n", j, yScl);
-		fprintf(outfile, "bumper [ %d ] . scl . z = %f\n", j, zScl);
-
-		fprintf(outfile, "\n");
+	free(check);
+	freeStageFile(&input);
+	if (roundTrip != 0) {
+		free(lz);
+		logPrintf(log, "ERROR: Compressed %s doesn't decompress back to the original\n", filename);
+		return -1;
 	}
 
-	fseek(lz, jamabars.offset, SEEK_SET);
-
-	for (int j = 0; j < jamabars.number; ++j) {
-		float xPos = readBigFloat(lz);
-		float yPos = readBigFloat(lz);
-		float zPos = readBigFloat(lz);
-
-		float xRot = readRot(lz);
-		float yRot = readRot(lz);
-		float zRot = readRot(lz);
-
-		fseek(lz, 2, SEEK_CUR);
-
-		float xScl = readBigFloat(lz);
-		float yScl = readBigFloat(lz);
-		float zScl = readBigFloat(lz);
-
-		fprintf(outfile, "jamabar [ %d ] . pos . x = %f\n", j, xPos);
-		fprintf(outfile, "jamabar [ %d ] . pos . y = %f\n", j, yPos);
-		fprintf(outfile, "jamabar [ %d ] . pos . z = %f\n", j, zPos);
+	// Make the output file name
+	char outfileName[OUTPUT_NAME_SIZE];
+	if (makeOutputName(outfileName, sizeof(outfileName), filename, ".lz") != 0) {
+		free(lz);
+		logPrintf(log, "Filename too long: %s\n", filename);
+		return -1;
+	}
 
-		fprintf(outfile, "jamabar [ %d ] . rot . x = %f\n", j, xRot);
-		fprintf(outfile, "jamabar [ %d ] . rot . y = %f\n", j, yRot);
-		fprintf(outfile, "jamabar [ %d ] . rot . z = %f\n", j, zRot);
+	StageFile output;
+	initStageFile(&output, lz, lzSize);
+	int result = writeStageFile(outfileName, &output);
+	freeStageFile(&output);
+	if (result != 0) {
+		logPrintf(log, "ERROR: Couldn't create %s\n", outfileName);
+		return -1;
+	}
 
+	logPrintf(log, "Finished Compressing %s (%" PRIu32 " bytes)\n", filename, lzSize);
+	return 0;
+}
 
-		fprintf(outfile, "jamabar [ %d ] . scl . x = %f\n", j, xScl);
-		fprintf(outfile, "jamabar [ %d ] . scl . y = %f\n", j, yScl);
-		fprintf(outfile, "jamabar [ %d ] . scl . z = %f\n", j, zScl);
+static int writeChunk(void *userData, const uint8_t *data, uint32_t size) {
+	return fwrite(data, 1, size, (FILE *)userData) == size ? 0 : -1;
+}
 
-		fprintf(outfile, "\n");
+static int decompressToFile(const char* filename, FileLog *log) {
+	FILE* lz = fopen(filename, "rb");
+	if (lz == NULL) {
+		logPrintf(log, "ERROR: File not found: %s\n", filename);
+		return -1;
+	}
+	logPrintf(log, "Decompressing %s\n", filename);
+
+	fseek(lz, 0, SEEK_END);
+	long lzSize = ftell(lz);
+	fseek(lz, 0, SEEK_SET);
+
+	uint8_t chunk[0x10000];
+	SMBLZHeader header;
+	size_t read = fread(chunk, 1, SMB_LZ_HEADER_SIZE, lz);
+	if (lzSize < 0 || read != SMB_LZ_HEADER_SIZE || readSMBLZHeader(chunk, (uint32_t)lzSize, &header) != 0) {
+		fclose(lz);
+		logPrintf(log, "ERROR: Corrupt header in %s\n", filename);
+		return -1;
 	}
 
-	fseek(lz, bananas.offset, SEEK_SET);
-
-	for (int j = 0; j < bananas.number; ++j) {
-		float xPos = readBigFloat(lz);
-		float yPos = readBigFloat(lz);
-		float zPos = readBigFloat(lz);
+	// Make the output file name
+	char outfileName[OUTPUT_NAME_SIZE];
+	if (makeOutputName(outfileName, sizeof(outfileName), filename, ".raw") != 0) {
+		fclose(lz);
+		logPrintf(log, "Filename too long: %s\n", filename);
+		return -1;
+	}
+	FILE* outfile = fopen(outfileName, "wb");
+	if (outfile == NULL) {
+		fclose(lz);
+		logPrintf(log, "ERROR: Couldn't create %s\n", outfileName);
+		return -1;
+	}
 
-		int intType = readInt(lz);
-		char type = 'N';
-		if (intType == 1) {
-			type = 'B';
+	// Only the window and one input chunk are ever in memory
+	LZSSStream stream;
+	lzssStreamInit(&stream, header.decompressedSize);
+	uint32_t remaining = header.compressedSize - SMB_LZ_HEADER_SIZE;
+	int result = 0;
+	while (remaining > 0 && result == 0) {
+		size_t toRead = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+		read = fread(chunk, 1, toRead, lz);
+		if (read == 0) {
+			break;
 		}
-
-		fprintf(outfile, "banana [ %d ] . pos . x = %f\n", j, xPos);
-		fprintf(outfile, "banana [ %d ] . pos . y = %f\n", j, yPos);
-		fprintf(outfile, "banana [ %d ] . pos . z = %f\n", j, zPos);
-
-		fprintf(outfile, "banana [ %d ] . type . x = %c\n", j, type);
-
-		fprintf(outfile, "\n");
+		result = lzssStreamFeed(&stream, chunk, (uint32_t)read, &writeChunk, outfile);
+		remaining -= (uint32_t)read;
 	}
+	if (result == 0) {
+		result = lzssStreamFinish(&stream, &writeChunk, outfile);
+	}
+	fclose(outfile);
+	fclose(lz);
 
-	if (game == SMB1) {
-		int numAnims = 0;
-		fseek(lz, collisionFields.offset, SEEK_SET);
-
-		for (int j = 0; j < collisionFields.number; ++j) {
-
-
-			float xPosCenter = readBigFloat(lz);
-			float yPosCenter = readBigFloat(lz);
-			float zPosCenter = readBigFloat(lz);
-
-			float xRotCenter = readRot(lz);
-			float yRotCenter = readRot(lz);
-			float zRotCenter = readRot(lz);
-
-			fseek(lz, 2, SEEK_CUR);
-
-			int animationFrameOffset = readInt(lz);
-
-			if (!animationFrameOffset) {
-				fseek(lz, 172, SEEK_CUR);
-				continue;
-			}
-
-			++numAnims;
-
-			int nameOffsetOffset = readInt(lz);
-
-			int position = ftell(lz);
-
-			fseek(lz, nameOffsetOffset, SEEK_SET);
-			int nameOffset = readInt(lz);
-			fseek(lz, nameOffset, SEEK_SET);
-			char modelName[512];
-			char animFilename[512];
-
-			fscanf(lz, "%501s", modelName);
-			fseek(lz, position, SEEK_SET);
-
-			strcpy(animFilename, modelName);
-
-			int animObjlength = (int)strlen(animFilename);
-			animFilename[animObjlength + 0] = 'a';
-			animFilename[animObjlength + 1] = 'n';
-			animFilename[animObjlength + 2] = 'i';
-			animFilename[animObjlength + 3] = 'm';
-			animFilename[animObjlength + 4] = '.';
-			animFilename[animObjlength + 5] = 't';
-			animFilename[animObjlength + 6] = 'x';
-			animFilename[animObjlength + 7] = 't';
-			animFilename[animObjlength + 8] = '\0';
-
-			int numFrames = 0;
-			AnimFrame animFrames[4096];
-
-			memset(animFrames, 0, 120 * sizeof(AnimFrame));
-
-			fseek(lz, animationFrameOffset, SEEK_SET);
-			int numXRot = readInt(lz);
-			int offsetXRot = readInt(lz);
-			int numYRot = readInt(lz);
-			int offsetYRot = readInt(lz);
-			int numZRot = readInt(lz);
-			int offsetZRot = readInt(lz);
-
-			int numXPos = readInt(lz);
-			int offsetXPos = readInt(lz);
-			int numYPos = readInt(lz);
-			int offsetYPos = readInt(lz);
-			int numZPos = readInt(lz);
-			int offsetZPos = readInt(lz);
-
-			// First Pass: Collect Frame Times
-
-			fseek(lz, offsetXRot + 4, SEEK_SET);
-			for (int k = 0; k < numXRot; ++k) {
-				numFrames += insert(animFrames, numFrames, readBigFloat(lz));
-				fseek(lz, 16, SEEK_CUR);
-			}
-
-			fseek(lz, offsetYRot + 4, SEEK_SET);
-			for (int k = 0; k < numYRot; ++k) {
-				numFrames += insert(animFrames, numFrames, readBigFloat(lz));
-				fseek(lz, 16, SEEK_CUR);
-			}
-
-			fseek(lz, offsetZRot + 4, SEEK_SET);
-			for (int k = 0; k < numZRot; ++k) {
-				numFrames += insert(animFrames, numFrames, readBigFloat(lz));
-				fseek(lz, 16, SEEK_CUR);
-			}
-
-
-			fseek(lz, offsetXPos + 4, SEEK_SET);
-			for (int k = 0; k < numXPos; ++k) {
-				numFrames += insert(animFrames, numFrames, readBigFloat(lz));
-				fseek(lz, 16, SEEK_CUR);
-			}
-
-			fseek(lz, offsetYPos + 4, SEEK_SET);
-			for (int k = 0; k < numYPos; ++k) {
-				numFrames += insert(animFrames, numFrames, readBigFloat(lz));
-				fseek(lz, 16, SEEK_CUR);
-			}
-
-			fseek(lz, offsetZPos + 4, SEEK_SET);
-			for (int k = 0; k < numZPos; ++k) {
-				numFrames += insert(animFrames, numFrames, readBigFloat(lz));
-				fseek(lz, 16, SEEK_CUR);
-			}
-
-			// Second Pass: Collect Frame Data
-
-			for (int k = 0; k < numFrames; ++k) {
-
-				float prevTime = 0;
-				float prevAmount = 0;
-				char found = 0;
-
-				// Go all from data for this axis
-				fseek(lz, offsetXRot + 4, SEEK_SET);
-				for (int l = 0; l < numXRot; ++l) {
-					// Get the time and translation/rotation
-					float time = readBigFloat(lz);
-					float amount = readBigFloat(lz);
-
-					// If times match up, insert it
-					if (time == animFrames[k].time) {
-						animFrames[k].xRot = amount;
-						found = 1;
-						break;
-					}// If the time is too far, extrapolate
-					else if (time > animFrames[k].time) {
-						float fractionTime = time / prevTime;
-						float fractionAmount = (prevAmount + amount) * fractionTime;
-						animFrames[k].xRot = fractionAmount;
-						found = 1;
-						break;
-					}
-					prevTime = time;
-					prevAmount = amount;
-					fseek(lz, 12, SEEK_CUR);
-				}
-
-				if (!found) {
-					animFrames[k].xRot = 0;
-				}
-
-				found = 0;
-
-				// Go all from data for this axis
-				fseek(lz, (offsetYRot + 4), SEEK_SET);
-				for (int l = 0; l < numYRot; ++l) {
-					// Get the time and translation/rotation
-					float time = readBigFloat(lz);
-					float amount = readBigFloat(lz);
-
-					// If times match up, insert it
-					if (time == animFrames[k].time) {
-						animFrames[k].yRot = amount;
-						found = 1;
-						break;
-					}// If the time is too far, extrapolate
-					else if (time > animFrames[k].time) {
-						float fractionTime = time / prevTime;
-						float fractionAmount = (prevAmount + amount) * fractionTime;
-						animFrames[k].yRot = fractionAmount;
-						found = 1;
-						break;
-					}
-					prevTime = time;
-					prevAmount = amount;
-					fseek(lz, 12, SEEK_CUR);
-				}
-
-
-				if (!found) {
-					animFrames[k].yRot = 0;
-				}
-
-				found = 0;
-				// Go all from data for this axis
-				fseek(lz, (offsetZRot + 4), SEEK_SET);
-				for (int l = 0; l < numZRot; ++l) {
-					// Get the time and translation/rotation
-					float time = readBigFloat(lz);
-					float amount = readBigFloat(lz);
-
-					// If times match up, insert it
-					if (time == animFrames[k].time) {
-						animFrames[k].zRot = amount;
-						found = 1;
-						break;
-					}// If the time is too far, extrapolate
-					else if (time > animFrames[k].time) {
-						float fractionTime = time / prevTime;
-						float fractionAmount = (prevAmount + amount) * fractionTime;
-						animFrames[k].zRot = fractionAmount;
-						found = 1;
-						break;
-					}
-					prevTime = time;
-					prevAmount = amount;
-					fseek(lz, 12, SEEK_CUR);
-				}
-
-
-				if (!found) {
-					animFrames[k].zRot = 0;
-				}
-
-				found = 0;
-				// Go all from data for this axis
-				fseek(lz, (offsetXPos + 4), SEEK_SET);
-				for (int l = 0; l < numXPos; ++l) {
-					// Get the time and translation/rotation
-					float time = readBigFloat(lz);
-					float amount = readBigFloat(lz);
-
-					// If times match up, insert it
-					if (time == animFrames[k].time) {
-						animFrames[k].xPos = amount;
-						found = 1;
-						break;
-					}// If the time is too far, extrapolate
-					else if (time > animFrames[k].time) {
-						float fractionTime = time / prevTime;
-						float fractionAmount = (prevAmount + amount) * fractionTime;
-						animFrames[k].xPos = fractionAmount;
-						found = 1;
-						break;
-					}
-					prevTime = time;
-					prevAmount = amount;
-					fseek(lz, 12, SEEK_CUR);
-				}
-
-				if (!found) {
-					animFrames[k].xPos = 0;
-				}
-
-				found = 0;
-				// Go all from data for this axis
-				fseek(lz, (offsetYPos + 4), SEEK_SET);
-				for (int l = 0; l < numYPos; ++l) {
-					// Get the time and translation/rotation
-					float time = readBigFloat(lz);
-					float amount = readBigFloat(lz);
-
-					// If times match up, insert it
-					if (time == animFrames[k].time) {
-						animFrames[k].yPos = amount;
-						found = 1;
-						break;
-					}// If the time is too far, extrapolate
-					else if (time > animFrames[k].time) {
-						float fractionTime = time / prevTime;
-						float fractionAmount = (prevAmount + amount) * fractionTime;
-						animFrames[k].yPos = fractionAmount;
-						found = 1;
-						break;
-					}
-					prevTime = time;
-					prevAmount = amount;
-					fseek(lz, 12, SEEK_CUR);
-				}
-
-				if (!found) {
-					animFrames[k].yPos = 0;
-				}
-
-				found = 0;
-				// Go all from data for this axis
-				fseek(lz, (offsetZPos + 4), SEEK_SET);
-				for (int l = 0; l < numZPos; ++l) {
-					// Get the time and translation/rotation
-					float time = readBigFloat(lz);
-					float amount = readBigFloat(lz);
-
-					// If times match up, insert it
-					if (time == animFrames[k].time) {
-						animFrames[k].zPos = amount;
-						found = 1;
-						break;
-					}// If the time is too far, extrapolate
-					else if (time > animFrames[k].time) {
-						float fractionTime = time / prevTime;
-						float fractionAmount = (prevAmount + amount) * fractionTime;
-						animFrames[k].zPos = fractionAmount;
-						found = 1;
-						break;
-					}
-					prevTime = time;
-					prevAmount = amount;
-					fseek(lz, 12, SEEK_CUR);
-				}
-
-				if (!found) {
-					animFrames[k].zPos = 0;
-				}
-
-			}
-
-
-			fseek(lz, position, SEEK_SET);
-			fseek(lz, 168, SEEK_CUR);
-
-			// Third Pass: Write the information
-
-			fprintf(outfile, "animobj [ %d ] . file . x = %s\n", numAnims, animFilename);
-			fprintf(outfile, "animobj [ %d ] . name . x = %s\n", numAnims, modelName);
-			fprintf(outfile, "animobj [ %d ] . center . x = %f\n", numAnims, xPosCenter);
-			fprintf(outfile, "animobj [ %d ] . center . y = %f\n", numAnims, yPosCenter);
-			fprintf(outfile, "animobj [ %d ] . center . z = %f\n", numAnims, zPosCenter);
-			fprintf(outfile, "\n");
-
-			FILE* animFile = fopen(animFilename, "w");
-
-			for (int k = 0; k < numFrames; ++k) {
-				fprintf(animFile, "frame [ %d ] . time . x = %f\n", k, animFrames[k].time);
-
-				fprintf(animFile, "frame [ %d ] . pos . x = %f\n", k, animFrames[k].xPos);
-				fprintf(animFile, "frame [ %d ] . pos . y = %f\n", k, animFrames[k].yPos);
-				fprintf(animFile, "frame [ %d ] . pos . z = %f\n", k, animFrames[k].zPos);
-
-				fprintf(animFile, "frame [ %d ] . rot . x = %f\n", k, animFrames[k].xRot + xRotCenter);
-				fprintf(animFile, "frame [ %d ] . rot . y = %f\n", k, animFrames[k].yRot + yRotCenter);
-				fprintf(animFile, "frame [ %d ] . rot . z = %f\n", k, animFrames[k].zRot + zRotCenter);
-
-				fprintf(animFile, "\n");
-			}
-			fclose(animFile);
+	if (result != 0) {
+		remove(outfileName);
+		logPrintf(log, "ERROR: Failed to decompress %s (data doesn't match the %" PRIu32 " byte size in the header)\n", filename, header.decompressedSize);
+		return -1;
+	}
+	logPrintf(log, "Finished Decompressing %s\n", filename);
+	return 0;
+}
 
+static int writeIndexFile(const char* filename, FileLog *log) {
+	StageFile lz;
+	if (mapStageFile(filename, &lz) != 0) {
+		logPrintf(log, "ERROR: File not found: %s\n", filename);
+		return -1;
+	}
+	logPrintf(log, "Indexing %s\n", filename);
+
+	// The window snapshots come from the decompressed data, so decode it all once
+	SMBLZHeader header;
+	uint8_t *decompressed = NULL;
+	int result = -1;
+	if (readSMBLZHeader(lz.data, lz.size, &header) == 0) {
+		decompressed = malloc(header.decompressedSize > 0 ? header.decompressedSize : 1);
+		if (decompressed != NULL) {
+			result = lzssDecode(lz.data + SMB_LZ_HEADER_SIZE, header.compressedSize - SMB_LZ_HEADER_SIZE, decompressed, header.decompressedSize);
 		}
 	}
-
-
-
-	fseek(lz, backgrounds.offset, SEEK_SET);
-
-	for (int j = 0; j < backgrounds.number; ++j) {
-
-
-		fseek(lz, 4, SEEK_CUR);
-		int nameOffset = readInt(lz);
-
-		int position = ftell(lz);
-
-		fseek(lz, nameOffset, SEEK_SET);
-		char modelName[512];
-
-		fscanf(lz, "%511s", modelName);
-		fseek(lz, position, SEEK_SET);
-
-		fseek(lz, 48, SEEK_CUR);
-
-		fprintf(outfile, "background [ %d ] . name . x = %s\n", j, modelName);
-
-
+	LZSSIndex index;
+	if (result == 0) {
+		result = lzssBuildIndex(lz.data, lz.size, decompressed, LZSS_INDEX_INTERVAL, &index);
 	}
-
-	if (backgrounds.number == 0) {
-		fprintf(outfile, "\n");
+	free(decompressed);
+	freeStageFile(&lz);
+	if (result != 0) {
+		logPrintf(log, "ERROR: Failed to decompress %s\n", filename);
+		return -1;
 	}
 
-	fclose(lz);
-	fclose(outfile);
+	char indexName[OUTPUT_NAME_SIZE];
+	result = makeOutputName(indexName, sizeof(indexName), filename, ".idx") == 0 ? lzssWriteIndex(indexName, &index) : -1;
+	uint32_t checkpointCount = index.checkpointCount;
+	lzssFreeIndex(&index);
+	if (result != 0) {
+		logPrintf(log, "ERROR: Couldn't create %s\n", indexName);
+		return -1;
+	}
+	logPrintf(log, "Finished Indexing %s (%" PRIu32 " checkpoints)\n", filename, checkpointCount);
+	return 0;
 }
 
-int decompress(const char* filename) {
-	// Try to open it
-	FILE* lz = fopen(filename, "rb");
-	if (lz == NULL) {
-		printf("ERROR: File not found: %s\n", filename);
+static int probeFile(const char* filename, FileLog *log) {
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL) {
+		logPrintf(log, "ERROR: File not found: %s\n", filename);
 		return -1;
 	}
-	printf("Decompressing %s\n", filename);
-
-	// Create a temp file for the unfixed lz (SMB lz has a slightly different header than FF7 LZS)
-	FILE* normal = tmpfile();
-
-	// Unfix the header (Turn it back into normal FF7 LZSS)
-	uint32_t csize = readLittleInt(lz) - 8;
-	fseek(lz, 4, SEEK_CUR);
-	putc(csize & 0xFF, normal);
-	putc((csize >> 8) & 0xFF, normal);
-	putc((csize >> 16) & 0xFF, normal);
-	putc((csize >> 24) & 0xFF, normal);
-	for (int j = 0; j < (int)(csize); j++) {
-		char c = (char)getc(lz);
-		putc(c, normal);
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	// Only the start of the file is ever read, even for lz files
+	uint8_t start[SMB_LZ_HEADER_SIZE + LZSS_PREFIX_INPUT_BOUND(STAGE_HEADER_SIZE)];
+	uint32_t startSize = (uint32_t)fread(start, 1, sizeof(start), file);
+	fclose(file);
+	if (fileSize < 0) {
+		logPrintf(log, "ERROR: Couldn't read %s\n", filename);
+		return -1;
 	}
-	fclose(lz);
-	fflush(normal);
-	fseek(normal, 0, SEEK_SET);
-
-	// Make the output file name
-	char outfileName[512];
-	sscanf(filename, "%507s", outfileName);
-	{
-		int nameLength = (int)strlen(outfileName);
-		outfileName[nameLength++] = '.';
-		outfileName[nameLength++] = 'r';
-		outfileName[nameLength++] = 'a';
-		outfileName[nameLength++] = 'w';
-		outfileName[nameLength++] = '\0';
-	}
-
-	// Open the output file for both reading and writing separately
-	// This is because you read bytes from the output buffer to write to the end and prevents constant fseeking
-	FILE* outfile = fopen(outfileName, "wb");
-	FILE* outfileR = fopen(outfileName, "rb");
-
-
-	// The size the the lzss data + 4 bytes for the header
-	uint32_t filesize = readLittleInt(normal) + 4;
-	printf("FILESIZE: %d\n", filesize);
-	int lastPercentDone = -1;
-
-	// Loop until we reach the end of the data or end of the file
-	while ((unsigned)ftell(normal) < filesize && !feof(normal)) {
-
-		float percentDone = (100.0f * ftell(normal)) / filesize;
-		int intPercentDone = (int)percentDone;
-		if (intPercentDone % 10 == 0 && intPercentDone != lastPercentDone) {
-			printf("%d%% Completed\n", intPercentDone);
-			lastPercentDone = intPercentDone;
-		}
-
-		// Read the first control block
-		// Read right to left, each bit specifies how the the next 8 spots of data will be
-		// 0 means write the byte directly to the output
-		// 1 represents there will be reference (2 byte)
-		uint8_t block = (uint8_t)getc(normal);
-
-		// Go through every bit in the control block
-		for (int j = 0; j < 8 && (unsigned)ftell(normal) < filesize && !feof(normal); ++j) {
-			// Literal
-			if (block & 0x01) {
-				putc(getc(normal), outfile);
-			}// Reference
-			else {
-				uint16_t reference = readBigShort(normal);
-
-				// Length is the last four bits + 3
-				// Any less than a lengh of 3 i pointess since a reference takes up 3 bytes
-				// Length is the last nibble (last 4 bits) of the 2 reference bytes
-				int length = (reference & 0x000F) + 3;
-
-				// Offset if is all 8 bits in the first reference byte and the first nibble (4 bits) in the second reference byte
-				// The nibble from the second reference byte comes before the first reference byte
-				// EX: reference bytes = 0x12 0x34
-				//     offset = 0x312
-				int offset = ((reference & 0xFF00) >> 8) | ((reference & 0x00F0) << 4);
-
-				// Convert the offset to how many bytes away from the end of the buffer to start reading from
-				int backSet = ((ftell(outfile) - 18 - offset) & 0xFFF);
-
-				// Calculate the actual location in the file
-				int readLocation = ftell(outfile) - backSet;
-
-				// Handle case where the offset is past the beginning of the file
-				while (readLocation < 0 && length > 0) {
-					putc(0, outfile);
-
-					--length;
-					++readLocation;
-				}
-
-				// Flush the file if data needs to be read from the outfile
-				if (length > 0) {
-					fflush(outfile);
-				}
-
-				// Seek to the reference position
-				fseek(outfileR, readLocation, SEEK_SET);
-
-				// Get the number of bytes until the current end of file (will need to flush once that is reached)
-				int buffer = ftell(outfile) - readLocation;
-				int curBuffer = 0;
-				// Read the reference bytes until we reach length bytes written
-				while (length > 0) {
-
-					// If at the previous end of file, flush the new data
-					if (curBuffer == buffer) {
-						// Flush the file so we don't read something that hasn't been properly updated
-						fflush(outfile);
-
-						curBuffer = 0;
-					}
-					putc(getc(outfileR), outfile);
-					++curBuffer;
-					--length;
-				}
 
-			}
-			// Go to the next reference bit in the block
-			block = block >> 1;
+	uint8_t header[STAGE_HEADER_SIZE];
+	uint32_t headerSize;
+	uint32_t stageSize;
+	size_t nameLength = strlen(filename);
+	if (nameLength >= 2 && filename[nameLength - 2] == 'l' && filename[nameLength - 1] == 'z') {
+		SMBLZHeader lzHeader;
+		if (readSMBLZHeader(start, (uint32_t)fileSize, &lzHeader) != 0) {
+			logPrintf(log, "%s: corrupt lz header\n", filename);
+			return -1;
+		}
+		stageSize = lzHeader.decompressedSize;
+		headerSize = stageSize < STAGE_HEADER_SIZE ? stageSize : STAGE_HEADER_SIZE;
+		uint32_t dataSize = lzHeader.compressedSize - SMB_LZ_HEADER_SIZE;
+		if (dataSize > startSize - SMB_LZ_HEADER_SIZE) {
+			dataSize = startSize - SMB_LZ_HEADER_SIZE;
+		}
+		if (lzssDecodePrefix(start + SMB_LZ_HEADER_SIZE, dataSize, header, stageSize, headerSize) != 0) {
+			logPrintf(log, "%s: corrupt lz data\n", filename);
+			return -1;
 		}
-
+	}
+	else {
+		stageSize = (uint32_t)fileSize;
+		headerSize = startSize < STAGE_HEADER_SIZE ? startSize : STAGE_HEADER_SIZE;
+		memcpy(header, start, headerSize);
 	}
 
-	fclose(outfileR);
-	fclose(outfile);
-	fclose(normal);
+	StageFile stage;
+	initStageFile(&stage, header, headerSize);
+	int game = determineGame(&stage);
+	if (game == -1) {
+		logPrintf(log, "%s: unknown game, %" PRIu32 " byte stage\n", filename, stageSize);
+		return -1;
+	}
 
-	printf("Finished Decompressing %s\n", filename);
+	uint32_t(*readHeaderInt)(StageFile*) = game == SMBX ? &readLittleInt : &readBigInt;
+	stageSeek(&stage, 0x8, SEEK_SET);
+	uint32_t collisionGroups = readHeaderInt(&stage);
+	stageSeek(&stage, 0x10, SEEK_SET);
+	uint32_t startOffset = readHeaderInt(&stage);
+	uint32_t falloutOffset = readHeaderInt(&stage);
+	stageSeek(&stage, game == SMB1 ? 0x68 : 0x58, SEEK_SET);
+	uint32_t backgroundModels = readHeaderInt(&stage);
+
+	const char *gameNames[] = { "SMB1", "SMB2", "SMBX" };
+	logPrintf(log, "%s: %s, %" PRIu32 " byte stage, %" PRIu32 " collision groups, %" PRIu32 " start positions, %" PRIu32 " background models%s\n",
+		filename, gameNames[game], stageSize, collisionGroups, (falloutOffset - startOffset) / 0x14, backgroundModels,
+		stageEof(&stage) ? " (truncated header)" : "");
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,112 @@
+#include "nameTable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "offsetMap.h"
+#include "threadPool.h"
+
+// Names are small, so they share blocks of this size (longer ones get a block of their own)
+#define NAME_BLOCK_SIZE 0x1000
+
+typedef struct NameBlock {
+	struct NameBlock *next;
+	uint32_t size;
+	uint32_t used;
+	char data[];
+}NameBlock;
+
+typedef struct {
+	OffsetKey key;      // Offset of the name, the number is always 0
+	const char *name;   // NULL if copying the name ran out of memory
+}NameSlot;
+
+struct NameTable {
+	ThreadLock *lock;   // NULL unless shared
+	OffsetMap slots;
+	NameBlock *blocks;
+};
+
+static char *copyName(NameTable *table, const char *name, uint32_t length) {
+	NameBlock *block = table->blocks;
+	if (block == NULL || block->size - block->used < length + 1) {
+		uint32_t blockSize = length + 1 > NAME_BLOCK_SIZE ? length + 1 : NAME_BLOCK_SIZE;
+		block = malloc(sizeof(NameBlock) + blockSize);
+		if (block == NULL) {
+			return NULL;
+		}
+		block->size = blockSize;
+		block->used = 0;
+		block->next = table->blocks;
+		table->blocks = block;
+	}
+	char *copy = block->data + block->used;
+	memcpy(copy, name, length);
+	copy[length] = '\0';
+	block->used += length + 1;
+	return copy;
+}
+
+NameTable *createNameTable(int shared) {
+	NameTable *table = calloc(1, sizeof(NameTable));
+	if (table == NULL) {
+		return NULL;
+	}
+	int slotsReady = initOffsetMap(&table->slots, sizeof(NameSlot), 32) == 0;
+	table->lock = shared ? createThreadLock() : NULL;
+	if (!slotsReady || (shared && table->lock == NULL)) {
+		destroyNameTable(table);
+		return NULL;
+	}
+	return table;
+}
+
+void destroyNameTable(NameTable *table) {
+	if (table == NULL) {
+		return;
+	}
+	NameBlock *block = table->blocks;
+	while (block != NULL) {
+		NameBlock *next = block->next;
+		free(block);
+		block = next;
+	}
+	freeOffsetMap(&table->slots);
+	destroyThreadLock(table->lock);
+	free(table);
+}
+
+const char *findName(NameTable *table, uint32_t offset) {
+	if (table->lock != NULL) {
+		acquireThreadLock(table->lock);
+	}
+	OffsetKey key = { offset, 0 };
+	const NameSlot *slot = offset != 0 ? findOffsetSlot(&table->slots, key) : NULL;
+	const char *name = slot != NULL ? slot->name : NULL;
+	if (table->lock != NULL) {
+		releaseThreadLock(table->lock);
+	}
+	return name;
+}
+
+const char *addName(NameTable *table, uint32_t offset, const char *name, uint32_t length) {
+	if (offset == 0 || length == UINT32_MAX) {
+		return NULL;
+	}
+	if (table->lock != NULL) {
+		acquireThreadLock(table->lock);
+	}
+	OffsetKey key = { offset, 0 };
+	NameSlot *slot = addOffsetSlot(&table->slots, key, NULL);
+	const char *copy = NULL;
+	if (slot != NULL) {
+		if (slot->name == NULL) {
+			slot->name = copyName(table, name, length);
+		}
+		copy = slot->name;
+	}
+	if (table->lock != NULL) {
+		releaseThreadLock(table->lock);
+	}
+	return copy;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+
+// Names a stage points to, each offset is read once and every later lookup gets the same copy back
+// The copies are packed into blocks owned by the table and stay put until it's destroyed
+typedef struct NameTable NameTable;
+
+// A shared table can be used from several threads at once
+// Returns NULL if out of memory
+NameTable *createNameTable(int shared);
+void destroyNameTable(NameTable *table);
+// Returns the name added for offset, or NULL if there isn't one yet
+const char *findName(NameTable *table, uint32_t offset);
+// Copies length bytes of name in and returns the copy, NULL if out of memory
+// If the offset was added in the meantime (by another thread) that copy is returned instead
+const char *addName(NameTable *table, uint32_t offset, const char *name, uint32_t length);
@@ -0,0 +1,99 @@
+#include "offsetMap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define OFFSET_MAP_MIN_BITS 4
+
+static uint32_t hashKey(OffsetKey key, uint32_t slotBits) {
+	// Multiplying only carries upwards, so the top bits are the ones that depend on every bit of the key
+	// (offsets are mostly 4 byte aligned, masking off the low bits would leave most slots unused)
+	uint32_t hash = (key.offset ^ key.number * 0x85EBCA6Bu) * 0x9E3779B1u;
+	return hash >> (32 - slotBits);
+}
+
+static int isEmptySlot(const uint8_t *slot) {
+	const OffsetKey *key = (const OffsetKey *)slot;
+	return key->offset == 0 && key->number == 0;
+}
+
+// The slot holding key or the empty one it would go in
+static uint8_t *probeSlot(const OffsetMap *map, OffsetKey key) {
+	uint32_t mask = (1u << map->slotBits) - 1;
+	uint32_t index = hashKey(key, map->slotBits);
+	for (;;) {
+		uint8_t *slot = map->slots + index * map->slotSize;
+		const OffsetKey *slotKey = (const OffsetKey *)slot;
+		if (isEmptySlot(slot) || (slotKey->offset == key.offset && slotKey->number == key.number)) {
+			return slot;
+		}
+		index = (index + 1) & mask;
+	}
+}
+
+static int growSlots(OffsetMap *map) {
+	uint32_t slotBits = map->slotBits + 1;
+	if (slotBits >= 32) {
+		return -1;
+	}
+	uint8_t *slots = calloc((size_t)1 << slotBits, map->slotSize);
+	if (slots == NULL) {
+		return -1;
+	}
+	uint8_t *oldSlots = map->slots;
+	uint32_t oldSlotCount = 1u << map->slotBits;
+	map->slots = slots;
+	map->slotBits = slotBits;
+	for (uint32_t i = 0; i < oldSlotCount; i++) {
+		uint8_t *slot = oldSlots + i * map->slotSize;
+		if (!isEmptySlot(slot)) {
+			memcpy(probeSlot(map, *(const OffsetKey *)slot), slot, map->slotSize);
+		}
+	}
+	free(oldSlots);
+	return 0;
+}
+
+int initOffsetMap(OffsetMap *map, size_t slotSize, uint32_t capacity) {
+	map->slotSize = slotSize;
+	map->slotBits = OFFSET_MAP_MIN_BITS;
+	map->count = 0;
+	while (map->slotBits < 31 && (uint64_t)capacity * 2 > (1u << map->slotBits)) {
+		map->slotBits++;
+	}
+	map->slots = calloc((size_t)1 << map->slotBits, slotSize);
+	return map->slots != NULL ? 0 : -1;
+}
+
+void freeOffsetMap(OffsetMap *map) {
+	free(map->slots);
+	map->slots = NULL;
+	map->count = 0;
+}
+
+void *findOffsetSlot(const OffsetMap *map, OffsetKey key) {
+	uint8_t *slot = probeSlot(map, key);
+	return isEmptySlot(slot) ? NULL : slot;
+}
+
+void *addOffsetSlot(OffsetMap *map, OffsetKey key, int *added) {
+	if (added != NULL) {
+		*added = 0;
+	}
+	uint8_t *slot = probeSlot(map, key);
+	if (!isEmptySlot(slot)) {
+		return slot;
+	}
+	if ((uint64_t)(map->count + 1) * 2 > (1u << map->slotBits)) {
+		if (growSlots(map) != 0) {
+			return NULL;
+		}
+		slot = probeSlot(map, key);
+	}
+	memcpy(slot, &key, sizeof(key));
+	map->count++;
+	if (added != NULL) {
+		*added = 1;
+	}
+	return slot;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Every slot of an OffsetMap starts with its key, things in a stage are found by where they are and how many there are
+// A slot is empty while both are 0, so (0, 0) can't be used as a key
+typedef struct {
+	uint32_t offset;
+	uint32_t number;
+}OffsetKey;
+
+// Open addressed table of fixed size slots, grows to stay at most half full
+typedef struct {
+	uint8_t *slots;
+	size_t slotSize;
+	uint32_t slotBits;      // There are 1 << slotBits slots
+	uint32_t count;
+}OffsetMap;
+
+// Makes room for capacity keys before the slots first have to grow
+// Returns -1 if out of memory
+int initOffsetMap(OffsetMap *map, size_t slotSize, uint32_t capacity);
+void freeOffsetMap(OffsetMap *map);
+// Returns the slot holding key, or NULL if there isn't one
+void *findOffsetSlot(const OffsetMap *map, OffsetKey key);
+// Returns the slot holding key, taking an empty one for it if there isn't one yet (added, if given, is set to 1 then)
+// The rest of a new slot is zeroed, returns NULL if the slots couldn't grow to fit it
+void *addOffsetSlot(OffsetMap *map, OffsetKey key, int *added);
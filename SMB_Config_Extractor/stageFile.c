@@ -0,0 +1,268 @@
+#include "stageFile.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct LazyStage {
+	StageFile lz;
+	LZSSIndex index;
+	uint8_t *decoded;   // One flag per checkpoint
+	int error;
+};
+
+void initStageFile(StageFile *stage, uint8_t *data, uint32_t size) {
+	stage->data = data;
+	stage->size = size;
+	stage->pos = 0;
+	stage->limit = size;
+	stage->eof = 0;
+	stage->mapped = 0;
+	stage->lazy = NULL;
+}
+
+int loadStageFile(const char *filename, StageFile *stage) {
+	initStageFile(stage, NULL, 0);
+	FILE *input = fopen(filename, "rb");
+	if (input == NULL) {
+		return -1;
+	}
+
+	fseek(input, 0, SEEK_END);
+	long size = ftell(input);
+	fseek(input, 0, SEEK_SET);
+	if (size < 0) {
+		fclose(input);
+		return -1;
+	}
+
+	// Always allocate at least one byte so an empty file still has a valid buffer
+	uint8_t *data = malloc(size > 0 ? (size_t)size : 1);
+	if (data == NULL) {
+		fclose(input);
+		return -1;
+	}
+	size_t read = fread(data, 1, (size_t)size, input);
+	fclose(input);
+
+	initStageFile(stage, data, (uint32_t)read);
+	return 0;
+}
+
+int mapStageFile(const char *filename, StageFile *stage) {
+	initStageFile(stage, NULL, 0);
+	uint8_t *view = NULL;
+	uint64_t size = 0;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return -1;
+	}
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 && fileSize.QuadPart <= UINT32_MAX) {
+		size = (uint64_t)fileSize.QuadPart;
+		// The view stays valid after both handles are closed
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL) {
+			view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0) {
+		return -1;
+	}
+	struct stat fileInfo;
+	if (fstat(file, &fileInfo) == 0 && fileInfo.st_size > 0 && (uint64_t)fileInfo.st_size <= UINT32_MAX) {
+		size = (uint64_t)fileInfo.st_size;
+		// The mapping stays valid after the descriptor is closed
+		void *mapping = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapping != MAP_FAILED) {
+			view = mapping;
+		}
+	}
+	close(file);
+#endif
+
+	// Empty files can't be mapped
+	if (view == NULL) {
+		return loadStageFile(filename, stage);
+	}
+	initStageFile(stage, view, (uint32_t)size);
+	stage->mapped = 1;
+	return 0;
+}
+
+static void unmapStageFile(StageFile *stage) {
+#ifdef _WIN32
+	UnmapViewOfFile(stage->data);
+#else
+	munmap(stage->data, stage->size);
+#endif
+}
+
+int openIndexedStageFile(StageFile *stage, StageFile *lz, LZSSIndex *index) {
+	initStageFile(stage, NULL, 0);
+	if (!lzssIndexMatches(index, lz->data, lz->size)) {
+		return -1;
+	}
+
+	LazyStage *lazy = malloc(sizeof(LazyStage));
+	uint8_t *data = malloc(index->decompressedSize > 0 ? index->decompressedSize : 1);
+	uint8_t *decoded = calloc(index->checkpointCount, 1);
+	if (lazy == NULL || data == NULL || decoded == NULL) {
+		free(lazy);
+		free(data);
+		free(decoded);
+		return -1;
+	}
+	lazy->lz = *lz;
+	initStageFile(lz, NULL, 0);
+	lazy->index = *index;
+	lazy->decoded = decoded;
+	lazy->error = 0;
+
+	initStageFile(stage, data, index->decompressedSize);
+	stage->lazy = lazy;
+	// Nothing is decoded yet, the first read takes the slow path
+	stage->limit = 0;
+	return 0;
+}
+
+// Decodes the checkpoint range holding pos if it isn't already
+static int decodeChunkAt(StageFile *stage, uint32_t pos, uint32_t *chunkEnd) {
+	LazyStage *lazy = stage->lazy;
+	uint32_t chunk = lzssIndexFindChunk(&lazy->index, pos);
+	if (!lazy->decoded[chunk]) {
+		if (lazy->error || lzssDecodeChunk(lazy->lz.data, lazy->lz.size, &lazy->index, chunk, stage->data) != 0) {
+			// Treat a corrupt range like the end of the file
+			lazy->error = 1;
+			return -1;
+		}
+		lazy->decoded[chunk] = 1;
+	}
+	*chunkEnd = lzssIndexChunkEnd(&lazy->index, chunk);
+	return 0;
+}
+
+void stageUpdateLimit(StageFile *stage) {
+	LazyStage *lazy = stage->lazy;
+	stage->limit = stage->pos;
+	if (stage->pos >= stage->size) {
+		return;
+	}
+	uint32_t chunk = lzssIndexFindChunk(&lazy->index, stage->pos);
+	if (lazy->decoded[chunk]) {
+		stage->limit = lzssIndexChunkEnd(&lazy->index, chunk);
+	}
+}
+
+int stageGetcSlow(StageFile *stage) {
+	uint32_t chunkEnd;
+	if (stage->pos >= stage->size || stage->lazy == NULL || decodeChunkAt(stage, stage->pos, &chunkEnd) != 0) {
+		stage->eof = 1;
+		return EOF;
+	}
+	stage->limit = chunkEnd;
+	return stage->data[stage->pos++];
+}
+
+uint32_t stageResidentEnd(StageFile *stage, uint32_t pos) {
+	uint32_t chunkEnd;
+	if (pos >= stage->size) {
+		return pos;
+	}
+	if (stage->lazy == NULL) {
+		return stage->size;
+	}
+	if (decodeChunkAt(stage, pos, &chunkEnd) != 0) {
+		return pos;
+	}
+	return chunkEnd;
+}
+
+uint32_t stageResidentSpan(StageFile *stage, uint32_t pos, uint32_t size) {
+	if (pos >= stage->size) {
+		return 0;
+	}
+	if (size > stage->size - pos) {
+		size = stage->size - pos;
+	}
+	uint32_t end = pos;
+	while (end - pos < size) {
+		uint32_t next = stageResidentEnd(stage, end);
+		if (next == end) {
+			break;
+		}
+		end = next;
+	}
+	return end - pos < size ? end - pos : size;
+}
+
+int cursorGetcSlow(StageCursor *cursor) {
+	// Reads past the end of the stage (or a corrupt lazy range) come back as zero
+	if (cursor->offset >= cursor->stage->size) {
+		cursor->offset++;
+		return 0;
+	}
+	cursor->limit = stageResidentEnd(cursor->stage, cursor->offset);
+	if (cursor->offset >= cursor->limit) {
+		cursor->offset++;
+		return 0;
+	}
+	return cursor->base[cursor->offset++];
+}
+
+int loadWholeStageFile(StageFile *stage) {
+	if (stage->lazy == NULL) {
+		return 0;
+	}
+	uint32_t pos = 0;
+	while (pos < stage->size) {
+		if (decodeChunkAt(stage, pos, &pos) != 0) {
+			return -1;
+		}
+	}
+	stageUpdateLimit(stage);
+	return 0;
+}
+
+int writeStageFile(const char *filename, StageFile *stage) {
+	if (loadWholeStageFile(stage) != 0) {
+		return -1;
+	}
+	FILE *output = fopen(filename, "wb");
+	if (output == NULL) {
+		return -1;
+	}
+	size_t written = fwrite(stage->data, 1, stage->size, output);
+	fclose(output);
+	return written == stage->size ? 0 : -1;
+}
+
+void freeStageFile(StageFile *stage) {
+	if (stage->lazy != NULL) {
+		freeStageFile(&stage->lazy->lz);
+		lzssFreeIndex(&stage->lazy->index);
+		free(stage->lazy->decoded);
+		free(stage->lazy);
+	}
+	if (stage->mapped) {
+		unmapStageFile(stage);
+	}
+	else {
+		free(stage->data);
+	}
+	initStageFile(stage, NULL, 0);
+}
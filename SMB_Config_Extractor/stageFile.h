@@ -0,0 +1,130 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+
+#include "lzss.h"
+
+// An lz stage that is only decoded as it's read, one index checkpoint at a time
+typedef struct LazyStage LazyStage;
+
+// A whole (decompressed) stage held in memory or mapped from the file
+// Reading mirrors the stdio calls the extractors were written against
+typedef struct {
+	uint8_t *data;
+	uint32_t size;
+	uint32_t pos;
+	uint32_t limit;    // Everything from pos up to here can be read directly
+	int eof;
+	int mapped;        // data is a read only view of the file rather than a heap copy
+	LazyStage *lazy;   // NULL unless the stage is decoded on demand
+}StageFile;
+
+void initStageFile(StageFile *stage, uint8_t *data, uint32_t size);
+int loadStageFile(const char *filename, StageFile *stage);
+// Maps the file into memory instead of copying it, falls back to loadStageFile where that isn't possible
+// The data must not be written to
+int mapStageFile(const char *filename, StageFile *stage);
+// Opens an lz file using its seek index, takes ownership of lz and index
+// Returns 0 on success, -1 if the index doesn't belong to lz (lz is left alone)
+int openIndexedStageFile(StageFile *stage, StageFile *lz, LZSSIndex *index);
+// Decodes whatever parts of an indexed stage haven't been read yet
+int loadWholeStageFile(StageFile *stage);
+int writeStageFile(const char *filename, StageFile *stage);
+void freeStageFile(StageFile *stage);
+
+// Slow paths for reads past limit, either the end of the stage or the end of the decoded data
+int stageGetcSlow(StageFile *stage);
+void stageUpdateLimit(StageFile *stage);
+
+// Returns 1 if the next size bytes can be read straight from data
+static inline int stageHas(const StageFile *stage, uint32_t size) {
+	return stage->limit >= size && stage->pos <= stage->limit - size;
+}
+
+static inline int stageGetc(StageFile *stage) {
+	if (stage->pos >= stage->limit) {
+		return stageGetcSlow(stage);
+	}
+	return stage->data[stage->pos++];
+}
+
+static inline int stageSeek(StageFile *stage, long offset, int origin) {
+	long newPos = offset;
+	if (origin == SEEK_CUR) {
+		newPos += (long)stage->pos;
+	}
+	else if (origin == SEEK_END) {
+		newPos += (long)stage->size;
+	}
+	if (newPos < 0) {
+		return -1;
+	}
+	stage->pos = (uint32_t)newPos;
+	stage->eof = 0;
+	if (stage->lazy != NULL) {
+		stageUpdateLimit(stage);
+	}
+	return 0;
+}
+
+static inline long stageTell(const StageFile *stage) {
+	return (long)stage->pos;
+}
+
+static inline int stageEof(const StageFile *stage) {
+	return stage->eof;
+}
+
+// A read position inside a stage, passed by value so following an offset never moves the caller
+// Reads outside the stage return zeros instead of whatever was left in the stream
+typedef struct {
+	const uint8_t *base;
+	uint32_t offset;
+	uint32_t limit;    // Everything from offset up to here can be read directly
+	StageFile *stage;
+}StageCursor;
+
+// Returns how far past pos a lazy stage is decoded (decoding pos's range if needed), or pos if it can't be
+uint32_t stageResidentEnd(StageFile *stage, uint32_t pos);
+// Makes as much of the size bytes at pos readable straight from data as it can, returns how many are
+uint32_t stageResidentSpan(StageFile *stage, uint32_t pos, uint32_t size);
+int cursorGetcSlow(StageCursor *cursor);
+
+static inline StageCursor stageCursor(StageFile *stage, uint32_t offset) {
+	StageCursor cursor;
+	cursor.base = stage->data;
+	cursor.offset = offset;
+	// Lazy stages find out what's decoded on the first read
+	cursor.limit = stage->lazy == NULL ? stage->size : 0;
+	cursor.stage = stage;
+	return cursor;
+}
+
+// A child cursor for an offset read out of the stage
+static inline StageCursor cursorAt(StageCursor parent, uint32_t offset) {
+	return stageCursor(parent.stage, offset);
+}
+
+static inline int cursorInRange(StageCursor cursor) {
+	return cursor.offset < cursor.stage->size;
+}
+
+// Returns 1 if the next size bytes can be read straight from base
+static inline int cursorHas(const StageCursor *cursor, uint32_t size) {
+	return cursor->limit >= size && cursor->offset <= cursor->limit - size;
+}
+
+static inline int cursorGetc(StageCursor *cursor) {
+	if (cursor->offset >= cursor->limit) {
+		return cursorGetcSlow(cursor);
+	}
+	return cursor->base[cursor->offset++];
+}
+
+static inline void cursorSkip(StageCursor *cursor, uint32_t size) {
+	cursor->offset += size;
+}
+
+static inline long cursorTell(const StageCursor *cursor) {
+	return (long)cursor->offset;
+}
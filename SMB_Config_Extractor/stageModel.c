@@ -0,0 +1,76 @@
+#include "stageModel.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Small allocations are packed into blocks of this size, bigger ones get a block of their own
+#define MODEL_BLOCK_SIZE 0x10000
+#define MODEL_ALIGNMENT 16
+
+struct ModelBlock {
+	ModelBlock *next;
+	size_t size;
+	size_t used;
+};
+
+// The block header is padded so the memory after it keeps the alignment
+#define MODEL_BLOCK_HEADER_SIZE ((sizeof(ModelBlock) + MODEL_ALIGNMENT - 1) & ~(size_t)(MODEL_ALIGNMENT - 1))
+
+void initStageModel(StageModel *model) {
+	memset(model, 0, sizeof(StageModel));
+}
+
+void *stageModelAlloc(StageModel *model, size_t size) {
+	if (size > SIZE_MAX - MODEL_BLOCK_HEADER_SIZE - MODEL_ALIGNMENT) {
+		return NULL;
+	}
+	size = (size + MODEL_ALIGNMENT - 1) & ~(size_t)(MODEL_ALIGNMENT - 1);
+
+	ModelBlock *block = model->blocks;
+	if (block == NULL || block->size - block->used < size) {
+		size_t blockSize = size > MODEL_BLOCK_SIZE ? size : MODEL_BLOCK_SIZE;
+		block = malloc(MODEL_BLOCK_HEADER_SIZE + blockSize);
+		if (block == NULL) {
+			return NULL;
+		}
+		block->size = blockSize;
+		block->used = 0;
+		block->next = model->blocks;
+		model->blocks = block;
+	}
+
+	uint8_t *memory = (uint8_t *)block + MODEL_BLOCK_HEADER_SIZE + block->used;
+	block->used += size;
+	memset(memory, 0, size);
+	return memory;
+}
+
+void mergeStageModel(StageModel *model, StageModel *from) {
+	// Keep model's current block at the front so its free space is still used
+	ModelBlock *last = from->blocks;
+	if (last == NULL) {
+		return;
+	}
+	while (last->next != NULL) {
+		last = last->next;
+	}
+	if (model->blocks == NULL) {
+		model->blocks = from->blocks;
+	}
+	else {
+		last->next = model->blocks->next;
+		model->blocks->next = from->blocks;
+	}
+	from->blocks = NULL;
+}
+
+void freeStageModel(StageModel *model) {
+	ModelBlock *block = model->blocks;
+	while (block != NULL) {
+		ModelBlock *next = block->next;
+		free(block);
+		block = next;
+	}
+	destroyNameTable(model->names);
+	initStageModel(model);
+}
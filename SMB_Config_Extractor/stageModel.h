@@ -0,0 +1,215 @@
+#pragma once
+#include <stdint.h>
+
+#include "nameTable.h"
+#include "stageFile.h"
+#include "threadPool.h"
+#include "xmlbuddy.h"
+
+// Everything the config extractor reads out of a stage, decoded once and then handed to a writer
+// All of a model's arrays live in its own blocks and its names in its name table, freeStageModel releases them together
+
+typedef struct {
+	uint32_t easing;
+	float time;
+	float value;
+}Keyframe;
+
+// One animated value, only written if it has keyframes
+typedef struct {
+	uint32_t count;
+	Keyframe *keyframes;
+}KeyframeTrack;
+
+enum TRANSFORM_TRACK {
+	TRACK_ROT_X,
+	TRACK_ROT_Y,
+	TRACK_ROT_Z,
+	TRACK_POS_X,
+	TRACK_POS_Y,
+	TRACK_POS_Z,
+	NUM_TRANSFORM_TRACKS
+};
+
+enum FOG_TRACK {
+	TRACK_FOG_START,
+	TRACK_FOG_END,
+	TRACK_FOG_RED,
+	TRACK_FOG_GREEN,
+	TRACK_FOG_BLUE,
+	NUM_FOG_TRACKS
+};
+
+typedef struct {
+	int present;
+	KeyframeTrack tracks[NUM_TRANSFORM_TRACKS];
+}TransformAnimation;
+
+typedef struct {
+	VectorF32 position;
+	VectorF32 rotation;
+}StartPosition;
+
+typedef struct {
+	const char *name;              // NULL if the model doesn't have one
+	VectorF32 position;
+	VectorF32 rotation;
+	VectorF32 scale;
+	float animationLoopTime;
+	TransformAnimation animation;
+}BackgroundModel;
+
+typedef struct {
+	uint8_t type;
+	float start;
+	float end;
+	float red;
+	float green;
+	float blue;
+	int animationPresent;
+	KeyframeTrack animation[NUM_FOG_TRACKS];
+}Fog;
+
+typedef struct {
+	uint32_t triangleListOffset;
+	uint32_t gridTriangleListOffet;
+	float gridStartX;
+	float gridStartZ;
+	float gridStepX;
+	float gridStepZ;
+	uint32_t gridStepXCount;
+	uint32_t gridStepZCount;
+}CollisionGroupHeader;
+
+// Collision triangles of a field in the field's own space, only read when asked for
+typedef struct {
+	uint32_t triangleCount;
+	VectorF32 *vertices;    // 3 per triangle
+	VectorF32 *normals;     // 1 per triangle
+}CollisionMesh;
+
+typedef struct {
+	VectorF32 position;
+	VectorF32 rotation;
+	uint16_t type;
+}Goal;
+
+// Jamabars share the bumper layout
+typedef struct {
+	VectorF32 position;
+	VectorF32 rotation;
+	VectorF32 scale;
+}Bumper;
+
+typedef struct {
+	VectorF32 position;
+	uint32_t type;
+}Banana;
+
+// Cylinders only have a position and rotation as well
+typedef struct {
+	VectorF32 position;
+	VectorF32 rotation;
+}Cone;
+
+typedef struct {
+	VectorF32 position;
+}Sphere;
+
+typedef struct {
+	VectorF32 position;
+	VectorF32 scale;
+	VectorF32 rotation;
+}FalloutVolume;
+
+typedef struct {
+	VectorF32 position;
+	VectorF32 rotation;
+	uint16_t type;
+	uint16_t animGroupID;
+}Switch;
+
+// Wormholes refer to each other by name, which is given out by offset once the whole stage is parsed
+typedef struct {
+	int name;
+	uint32_t offset;
+	VectorF32 position;
+	VectorF32 rotation;
+	int destinationName;
+	uint32_t destinationOffset;
+}Wormhole;
+
+typedef struct {
+	VectorF32 centerOfRotation;
+	VectorI16 initialRotation;
+	uint16_t animSeesawType;
+	TransformAnimation animation;
+	VectorF32 conveyorSpeed;
+	CollisionGroupHeader collisionGrid;
+	CollisionMesh collisionMesh;
+	uint32_t goalCount;
+	Goal *goals;
+	uint32_t bumperCount;
+	Bumper *bumpers;
+	uint32_t jamabarCount;
+	Bumper *jamabars;
+	uint32_t bananaCount;
+	Banana *bananas;
+	uint32_t coneCount;
+	Cone *cones;
+	uint32_t sphereCount;
+	Sphere *spheres;
+	uint32_t cylinderCount;
+	Cone *cylinders;
+	uint32_t falloutVolumeCount;
+	FalloutVolume *falloutVolumes;
+	uint32_t reflectiveModelCount;
+	const char **reflectiveModels; // Names, NULL entries have none
+	uint32_t levelModelCount;
+	const char **levelModels;
+	uint16_t animGroupID;
+	uint32_t switchCount;
+	Switch *switches;
+	float seesawSensitivity;
+	float seesawStiffness;
+	float seesawBounds;
+	uint32_t wormholeCount;
+	Wormhole *wormholes;
+	uint32_t initialAnimState;
+	float animationLoopPoint;
+}CollisionField;
+
+typedef struct ModelBlock ModelBlock;
+
+typedef struct {
+	uint32_t startPositionCount;
+	StartPosition *startPositions;
+	int falloutPlanePresent;
+	float falloutPlane;
+	uint32_t backgroundModelCount;
+	BackgroundModel *backgroundModels;
+	int fogPresent;
+	Fog fog;
+	uint32_t collisionFieldCount;
+	CollisionField *collisionFields;
+	ModelBlock *blocks;
+	NameTable *names;               // Only the stage's own model has one, collision field models share it
+}StageModel;
+
+void initStageModel(StageModel *model);
+// Returns zeroed memory owned by the model, or NULL if it couldn't be allocated
+void *stageModelAlloc(StageModel *model, size_t size);
+// Hands all of from's memory over to model, from is left empty
+void mergeStageModel(StageModel *model, StageModel *from);
+void freeStageModel(StageModel *model);
+
+// Decodes an SMB2 or SMBX stage, returns 0 on success and -1 for other games or if memory ran out
+// Collision fields are parsed on the pool (if there is one) unless the stage is decoded lazily
+// Collision triangles are only decoded if collisionMeshes is set
+int parseStageModel(StageFile *stage, int game, StageModel *model, ThreadPool *pool, int collisionMeshes);
+// Writes the model as the xml config, everything inside the title tag
+// Collision fields are written to separate buffers on the pool (if there is one) and then output in order
+void writeStageModelXML(const StageModel *model, XMLBuddy *xmlBuddy, ThreadPool *pool);
+// Writes the collision meshes of every field as one binary PLY, each face is tagged with its field's index
+// Returns -1 if the file couldn't be written, a partly written file is removed
+int writeStageModelPLY(const StageModel *model, const char *filename);
@@ -0,0 +1,101 @@
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "stageModel.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FunctionsAndDefines.h"
+
+// Per vertex: x, y, z, nx, ny, nz as floats
+#define PLY_VERTEX_SIZE 24
+// Per face: an index count byte, 3 vertex indices, the collision field index
+#define PLY_FACE_SIZE 17
+
+static void writeFloatData(uint8_t *data, int offset, float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	writeLittleIntData(data, offset, bits);
+}
+
+static void writeVectorData(uint8_t *data, int offset, VectorF32 vector) {
+	writeFloatData(data, offset, vector.x);
+	writeFloatData(data, offset + 4, vector.y);
+	writeFloatData(data, offset + 8, vector.z);
+}
+
+int writeStageModelPLY(const StageModel *model, const char *filename) {
+	uint64_t triangleCount = 0;
+	uint32_t largestMesh = 0;
+	for (uint32_t i = 0; i < model->collisionFieldCount; i++) {
+		uint32_t count = model->collisionFields[i].collisionMesh.triangleCount;
+		triangleCount += count;
+		if (count > largestMesh) {
+			largestMesh = count;
+		}
+	}
+	// Vertex indices are 32 bit
+	if (triangleCount * 3 > UINT32_MAX) {
+		return -1;
+	}
+
+	FILE *output = fopen(filename, "wb");
+	if (output == NULL) {
+		return -1;
+	}
+	int result = fprintf(output, "ply\nformat binary_little_endian 1.0\ncomment Super Monkey Ball collision\n"
+		"element vertex %" PRIu64 "\nproperty float x\nproperty float y\nproperty float z\n"
+		"property float nx\nproperty float ny\nproperty float nz\n"
+		"element face %" PRIu64 "\nproperty list uchar uint vertex_indices\nproperty uint collision_field\nend_header\n",
+		triangleCount * 3, triangleCount) > 0 ? 0 : -1;
+
+	// Every vertex is written before any face, each mesh goes out in one write
+	size_t bufferSize = (size_t)largestMesh * (3 * PLY_VERTEX_SIZE > PLY_FACE_SIZE ? 3 * PLY_VERTEX_SIZE : PLY_FACE_SIZE);
+	uint8_t *buffer = largestMesh > 0 ? malloc(bufferSize) : NULL;
+	if (largestMesh > 0 && buffer == NULL) {
+		result = -1;
+	}
+	for (uint32_t i = 0; i < model->collisionFieldCount && result == 0; i++) {
+		const CollisionMesh *mesh = &model->collisionFields[i].collisionMesh;
+		for (uint32_t j = 0; j < mesh->triangleCount * 3; j++) {
+			uint8_t *vertex = buffer + (size_t)j * PLY_VERTEX_SIZE;
+			writeVectorData(vertex, 0, mesh->vertices[j]);
+			writeVectorData(vertex, 12, mesh->normals[j / 3]);
+		}
+		size_t size = (size_t)mesh->triangleCount * 3 * PLY_VERTEX_SIZE;
+		if (size > 0 && fwrite(buffer, 1, size, output) != size) {
+			result = -1;
+		}
+	}
+	uint32_t firstVertex = 0;
+	for (uint32_t i = 0; i < model->collisionFieldCount && result == 0; i++) {
+		const CollisionMesh *mesh = &model->collisionFields[i].collisionMesh;
+		for (uint32_t j = 0; j < mesh->triangleCount; j++) {
+			uint8_t *face = buffer + (size_t)j * PLY_FACE_SIZE;
+			face[0] = 3;
+			writeLittleIntData(face, 1, firstVertex);
+			writeLittleIntData(face, 5, firstVertex + 1);
+			writeLittleIntData(face, 9, firstVertex + 2);
+			writeLittleIntData(face, 13, i);
+			firstVertex += 3;
+		}
+		size_t size = (size_t)mesh->triangleCount * PLY_FACE_SIZE;
+		if (size > 0 && fwrite(buffer, 1, size, output) != size) {
+			result = -1;
+		}
+	}
+	free(buffer);
+
+	if (fclose(output) != 0) {
+		result = -1;
+	}
+	// A cut off file would pass for a finished one later on
+	if (result != 0) {
+		remove(filename);
+	}
+	return result;
+}
@@ -0,0 +1,269 @@
+#include "stageModel.h"
+
+#include <stdlib.h>
+
+#include "FunctionsAndDefines.h"
+#include "xmlbuddy.h"
+
+// Collision fields written at the same time, each into a buffer of its own
+typedef struct {
+	const CollisionField *fields;
+	XMLBuddy *buffers;
+}CollisionFieldWriteJob;
+
+// Xml writers for a parsed stage model
+static void writeCollisionFields(const StageModel *model, XMLBuddy *xmlBuddy, ThreadPool *pool);
+static void writeCollisionFieldTask(void *context, uint32_t index);
+static void writeCollisionField(XMLBuddy *xmlBuddy, const CollisionField *field);
+static void writeCollisionGrid(XMLBuddy *xmlBuddy, CollisionGroupHeader grid);
+static void writeTransformAnimation(XMLBuddy *xmlBuddy, const TransformAnimation *animation);
+static void writeKeyframeTrack(XMLBuddy *xmlBuddy, enum TAG_TYPE tagType, const KeyframeTrack *track);
+static void writeName(XMLBuddy *xmlBuddy, enum TAG_TYPE tagType, const char *name);
+
+void writeStageModelXML(const StageModel *model, XMLBuddy *xmlBuddy, ThreadPool *pool) {
+	for (uint32_t i = 0; i < model->startPositionCount; i++) {
+		const StartPosition *startPosition = &model->startPositions[i];
+		startTagType(xmlBuddy, TAG_START);
+		writeVectorF32(xmlBuddy, TAG_POSITION, startPosition->position);
+		writeVectorF32(xmlBuddy, TAG_ROTATION, startPosition->rotation);
+		endTag(xmlBuddy);
+	}
+
+	if (model->falloutPlanePresent) {
+		startTagType(xmlBuddy, TAG_FALLOUT_PLANE);
+		addAttrTypeDouble(xmlBuddy, ATTR_Y, model->falloutPlane);
+		endTag(xmlBuddy);
+	}
+
+	for (uint32_t i = 0; i < model->backgroundModelCount; i++) {
+		const BackgroundModel *backgroundModel = &model->backgroundModels[i];
+		startTagType(xmlBuddy, TAG_BACKGROUND_MODEL);
+		writeName(xmlBuddy, TAG_NAME, backgroundModel->name);
+		writeVectorF32(xmlBuddy, TAG_POSITION, backgroundModel->position);
+		writeVectorF32(xmlBuddy, TAG_ROTATION, backgroundModel->rotation);
+		writeVectorF32(xmlBuddy, TAG_SCALE, backgroundModel->scale);
+		if (backgroundModel->animation.present) {
+			writeTagWithFloatValue(xmlBuddy, TAG_ANIM_LOOP_TIME, backgroundModel->animationLoopTime);
+			writeTransformAnimation(xmlBuddy, &backgroundModel->animation);
+		}
+		endTag(xmlBuddy);
+	}
+
+	if (model->fogPresent) {
+		const Fog *fog = &model->fog;
+		startTagType(xmlBuddy, TAG_FOG);
+		writeFogType(xmlBuddy, fog->type);
+		writeTagWithFloatValue(xmlBuddy, TAG_START, fog->start);
+		writeTagWithFloatValue(xmlBuddy, TAG_END, fog->end);
+		writeTagWithFloatValue(xmlBuddy, TAG_RED, fog->red);
+		writeTagWithFloatValue(xmlBuddy, TAG_GREEN, fog->green);
+		writeTagWithFloatValue(xmlBuddy, TAG_BLUE, fog->blue);
+		if (fog->animationPresent) {
+			startTagType(xmlBuddy, TAG_ANIM_KEYFRAMES);
+			writeKeyframeTrack(xmlBuddy, TAG_START, &fog->animation[TRACK_FOG_START]);
+			writeKeyframeTrack(xmlBuddy, TAG_END, &fog->animation[TRACK_FOG_END]);
+			writeKeyframeTrack(xmlBuddy, TAG_RED, &fog->animation[TRACK_FOG_RED]);
+			writeKeyframeTrack(xmlBuddy, TAG_GREEN, &fog->animation[TRACK_FOG_GREEN]);
+			writeKeyframeTrack(xmlBuddy, TAG_BLUE, &fog->animation[TRACK_FOG_BLUE]);
+			endTag(xmlBuddy);
+		}
+		endTag(xmlBuddy);
+	}
+
+	writeCollisionFields(model, xmlBuddy, pool);
+}
+
+static void writeCollisionFields(const StageModel *model, XMLBuddy *xmlBuddy, ThreadPool *pool) {
+	uint32_t count = model->collisionFieldCount;
+	XMLBuddy *buffers = NULL;
+	if (pool != NULL && count > 1) {
+		buffers = malloc(count * sizeof(XMLBuddy));
+	}
+	if (buffers == NULL) {
+		for (uint32_t i = 0; i < count; i++) {
+			writeCollisionField(xmlBuddy, &model->collisionFields[i]);
+		}
+		return;
+	}
+
+	// Every buffer starts where the first field would be written, each field leaves the output as it found it
+	for (uint32_t i = 0; i < count; i++) {
+		initXMLBuddyBuffer(&buffers[i], xmlBuddy);
+	}
+	CollisionFieldWriteJob job;
+	job.fields = model->collisionFields;
+	job.buffers = buffers;
+	runThreadPool(pool, count, writeCollisionFieldTask, &job);
+
+	for (uint32_t i = 0; i < count; i++) {
+		// A buffer that ran out of memory is left out, its field is written straight to the output instead
+		if (appendXMLBuddy(xmlBuddy, &buffers[i]) != NO_ERROR) {
+			writeCollisionField(xmlBuddy, &model->collisionFields[i]);
+		}
+		closeXMlBuddy(&buffers[i]);
+	}
+	free(buffers);
+}
+
+static void writeCollisionFieldTask(void *context, uint32_t index) {
+	CollisionFieldWriteJob *job = context;
+	writeCollisionField(&job->buffers[index], &job->fields[index]);
+}
+
+static void writeCollisionField(XMLBuddy *xmlBuddy, const CollisionField *field) {
+	startTagType(xmlBuddy, TAG_ITEM_GROUP);
+	writeVectorF32(xmlBuddy, TAG_ROTATION_CENTER, field->centerOfRotation);
+	writeVectorI16(xmlBuddy, TAG_INITIAL_ROTATION, field->initialRotation);
+	writeAnimSeesawType(xmlBuddy, field->animSeesawType);
+	if (field->animation.present) {
+		writeTransformAnimation(xmlBuddy, &field->animation);
+	}
+	writeVectorF32(xmlBuddy, TAG_CONVEYOR_SPEED, field->conveyorSpeed);
+	writeCollisionGrid(xmlBuddy, field->collisionGrid);
+
+	for (uint32_t i = 0; i < field->goalCount; i++) {
+		startTagType(xmlBuddy, TAG_GOAL);
+		writeVectorF32(xmlBuddy, TAG_POSITION, field->goals[i].position);
+		writeVectorF32(xmlBuddy, TAG_ROTATION, field->goals[i].rotation);
+		writeGoalType(xmlBuddy, field->goals[i].type);
+		endTag(xmlBuddy);
+	}
+	for (uint32_t i = 0; i < field->bumperCount; i++) {
+		startTagType(xmlBuddy, TAG_BUMPER);
+		writeVectorF32(xmlBuddy, TAG_POSITION, field->bumpers[i].position);
+		writeVectorF32(xmlBuddy, TAG_ROTATION, field->bumpers[i].rotation);
+		writeVectorF32(xmlBuddy, TAG_SCALE, field->bumpers[i].scale);
+		endTag(xmlBuddy);
+	}
+	for (uint32_t i = 0; i < field->jamabarCount; i++) {
+		startTagType(xmlBuddy, TAG_JAMABAR);
+		writeVectorF32(xmlBuddy, TAG_POSITION, field->jamabars[i].position);
+		writeVectorF32(xmlBuddy, TAG_ROTATION, field->jamabars[i].rotation);
+		writeVectorF32(xmlBuddy, TAG_SCALE, field->jamabars[i].scale);
+		endTag(xmlBuddy);
+	}
+	for (uint32_t i = 0; i < field->bananaCount; i++) {
+		startTagType(xmlBuddy, TAG_BANANA);
+		writeVectorF32(xmlBuddy, TAG_POSITION, field->bananas[i].position);
+		writeBananaType(xmlBuddy, field->bananas[i].type);
+		endTag(xmlBuddy);
+	}
+	for (uint32_t i = 0; i < field->coneCount; i++) {
+		startTagType(xmlBuddy, TAG_CONE);
+		writeVectorF32(xmlBuddy, TAG_POSITION, field->cones[i].position);
+		writeVectorF32(xmlBuddy, TAG_ROTATION, field->cones[i].rotation);
+		endTag(xmlBuddy);
+	}
+	for (uint32_t i = 0; i < field->sphereCount; i++) {
+		startTagType(xmlBuddy, TAG_SPHERE);
+		writeVectorF32(xmlBuddy, TAG_POSITION, field->spheres[i].position);
+		endTag(xmlBuddy);
+	}
+	for (uint32_t i = 0; i < field->cylinderCount; i++) {
+		startTagType(xmlBuddy, TAG_CYLINDER);
+		writeVectorF32(xmlBuddy, TAG_POSITION, field->cylinders[i].position);
+		writeVectorF32(xmlBuddy, TAG_ROTATION, field->cylinders[i].rotation);
+		endTag(xmlBuddy);
+	}
+	for (uint32_t i = 0; i < field->falloutVolumeCount; i++) {
+		startTagType(xmlBuddy, TAG_FALLOUT_VOLUME);
+		writeVectorF32(xmlBuddy, TAG_POSITION, field->falloutVolumes[i].position);
+		writeVectorF32(xmlBuddy, TAG_SCALE, field->falloutVolumes[i].scale);
+		writeVectorF32(xmlBuddy, TAG_ROTATION, field->falloutVolumes[i].rotation);
+		endTag(xmlBuddy);
+	}
+	for (uint32_t i = 0; i < field->reflectiveModelCount; i++) {
+		writeName(xmlBuddy, TAG_REFLECTIVE_MODEL, field->reflectiveModels[i]);
+	}
+	for (uint32_t i = 0; i < field->levelModelCount; i++) {
+		writeName(xmlBuddy, TAG_LEVEL_MODEL, field->levelModels[i]);
+	}
+
+	writeTagWithUInt32Value(xmlBuddy, TAG_ANIM_GROUP_ID, field->animGroupID);
+
+	for (uint32_t i = 0; i < field->switchCount; i++) {
+		startTagType(xmlBuddy, TAG_SWITCH);
+		writeVectorF32(xmlBuddy, TAG_POSITION, field->switches[i].position);
+		writeVectorF32(xmlBuddy, TAG_ROTATION, field->switches[i].rotation);
+		writeAnimType(xmlBuddy, TAG_TYPE, field->switches[i].type);
+		startTagType(xmlBuddy, TAG_ANIM_GROUP_ID);
+		addValUInt32(xmlBuddy, (uint32_t)field->switches[i].animGroupID);
+		endTag(xmlBuddy);
+		endTag(xmlBuddy);
+	}
+
+	writeTagWithFloatValue(xmlBuddy, TAG_SEESAW_SENSITIVITY, field->seesawSensitivity);
+	writeTagWithFloatValue(xmlBuddy, TAG_SEESAW_STIFFNESS, field->seesawStiffness);
+	writeTagWithFloatValue(xmlBuddy, TAG_SEESAW_BOUNDS, field->seesawBounds);
+
+	for (uint32_t i = 0; i < field->wormholeCount; i++) {
+		startTagType(xmlBuddy, TAG_WORMHOLE);
+		writeTagWithInt32Value(xmlBuddy, TAG_NAME, field->wormholes[i].name);
+		writeVectorF32(xmlBuddy, TAG_POSITION, field->wormholes[i].position);
+		writeVectorF32(xmlBuddy, TAG_ROTATION, field->wormholes[i].rotation);
+		writeTagWithInt32Value(xmlBuddy, TAG_DESTINATION_NAME, field->wormholes[i].destinationName);
+		endTag(xmlBuddy);
+	}
+
+	writeAnimType(xmlBuddy, TAG_ANIM_INITIAL_STATE, (uint16_t)field->initialAnimState);
+	writeTagWithFloatValue(xmlBuddy, TAG_ANIM_LOOP_TIME, field->animationLoopPoint);
+	endTag(xmlBuddy);
+}
+
+static void writeCollisionGrid(XMLBuddy *xmlBuddy, CollisionGroupHeader grid) {
+	startTagType(xmlBuddy, TAG_COLLISION_GRID);
+
+	startTagType(xmlBuddy, TAG_START);
+	addAttrTypeDouble(xmlBuddy, ATTR_X, grid.gridStartX);
+	addAttrTypeDouble(xmlBuddy, ATTR_Z, grid.gridStartZ);
+	endTag(xmlBuddy);
+
+	startTagType(xmlBuddy, TAG_STEP);
+	addAttrTypeDouble(xmlBuddy, ATTR_X, grid.gridStepX);
+	addAttrTypeDouble(xmlBuddy, ATTR_Z, grid.gridStepZ);
+	endTag(xmlBuddy);
+
+	startTagType(xmlBuddy, TAG_COUNT);
+	addAttrTypeDouble(xmlBuddy, ATTR_X, grid.gridStepXCount);
+	addAttrTypeDouble(xmlBuddy, ATTR_Z, grid.gridStepZCount);
+	endTag(xmlBuddy);
+
+	endTag(xmlBuddy);
+}
+
+static void writeTransformAnimation(XMLBuddy *xmlBuddy, const TransformAnimation *animation) {
+	startTagType(xmlBuddy, TAG_ANIM_KEYFRAMES);
+	writeKeyframeTrack(xmlBuddy, TAG_ROT_X, &animation->tracks[TRACK_ROT_X]);
+	writeKeyframeTrack(xmlBuddy, TAG_ROT_Y, &animation->tracks[TRACK_ROT_Y]);
+	writeKeyframeTrack(xmlBuddy, TAG_ROT_Z, &animation->tracks[TRACK_ROT_Z]);
+	writeKeyframeTrack(xmlBuddy, TAG_POS_X, &animation->tracks[TRACK_POS_X]);
+	writeKeyframeTrack(xmlBuddy, TAG_POS_Y, &animation->tracks[TRACK_POS_Y]);
+	writeKeyframeTrack(xmlBuddy, TAG_POS_Z, &animation->tracks[TRACK_POS_Z]);
+	endTag(xmlBuddy);
+}
+
+static void writeKeyframeTrack(XMLBuddy *xmlBuddy, enum TAG_TYPE tagType, const KeyframeTrack *track) {
+	if (track->count == 0) return;
+	startTagType(xmlBuddy, tagType);
+
+	for (uint32_t i = 0; i < track->count; i++) {
+		const Keyframe *keyframe = &track->keyframes[i];
+		startTagType(xmlBuddy, TAG_KEYFRAME);
+		addAttrTypeDouble(xmlBuddy, ATTR_TIME, keyframe->time);
+		addAttrTypeDouble(xmlBuddy, ATTR_VALUE, keyframe->value);
+		writeAnimEasingVal(xmlBuddy, keyframe->easing);
+
+		endTag(xmlBuddy);
+	}
+
+	endTag(xmlBuddy);
+}
+
+// Names that weren't in the stage leave the tag empty
+static void writeName(XMLBuddy *xmlBuddy, enum TAG_TYPE tagType, const char *name) {
+	startTagType(xmlBuddy, tagType);
+	if (name != NULL) {
+		addValStr(xmlBuddy, (char *)name);
+	}
+	endTag(xmlBuddy);
+}
@@ -0,0 +1,274 @@
+#include "threadPool.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+typedef HANDLE PoolThread;
+typedef CRITICAL_SECTION PoolMutex;
+typedef CONDITION_VARIABLE PoolCondition;
+#define initMutex(mutex) InitializeCriticalSection(mutex)
+#define destroyMutex(mutex) DeleteCriticalSection(mutex)
+#define lockMutex(mutex) EnterCriticalSection(mutex)
+#define unlockMutex(mutex) LeaveCriticalSection(mutex)
+#define initCondition(condition) InitializeConditionVariable(condition)
+#define destroyCondition(condition) ((void)(condition))
+#define waitCondition(condition, mutex) SleepConditionVariableCS(condition, mutex, INFINITE)
+#define signalCondition(condition) WakeConditionVariable(condition)
+#define broadcastCondition(condition) WakeAllConditionVariable(condition)
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_t PoolThread;
+typedef pthread_mutex_t PoolMutex;
+typedef pthread_cond_t PoolCondition;
+#define initMutex(mutex) pthread_mutex_init(mutex, NULL)
+#define destroyMutex(mutex) pthread_mutex_destroy(mutex)
+#define lockMutex(mutex) pthread_mutex_lock(mutex)
+#define unlockMutex(mutex) pthread_mutex_unlock(mutex)
+#define initCondition(condition) pthread_cond_init(condition, NULL)
+#define destroyCondition(condition) pthread_cond_destroy(condition)
+#define waitCondition(condition, mutex) pthread_cond_wait(condition, mutex)
+#define signalCondition(condition) pthread_cond_signal(condition)
+#define broadcastCondition(condition) pthread_cond_broadcast(condition)
+#endif
+
+// A job lives on the stack of the thread that runs it until all of its tasks have finished
+typedef struct PoolJob {
+	struct PoolJob *older;
+	ThreadPoolTask task;
+	void *context;
+	uint32_t count;
+	uint32_t next;
+	uint32_t finished;
+}PoolJob;
+
+struct ThreadPool {
+	PoolMutex mutex;
+	PoolCondition workReady;    // A job was started or the pool is shutting down
+	PoolCondition workDone;     // The last task of some job finished
+	PoolThread *threads;
+	int threadCount;
+	int shutdown;
+
+	// Jobs that are still running, newest first
+	// Tasks started by other tasks are pushed on top, so idle threads help finish those first
+	PoolJob *jobs;
+};
+
+// The newest job with tasks nobody has taken yet, called with the mutex held
+static PoolJob *findOpenJob(ThreadPool *pool) {
+	PoolJob *job = pool->jobs;
+	while (job != NULL && job->next >= job->count) {
+		job = job->older;
+	}
+	return job;
+}
+
+// Takes the next task of job and runs it, called with the mutex held
+static void workOnTask(ThreadPool *pool, PoolJob *job) {
+	uint32_t index = job->next++;
+
+	unlockMutex(&pool->mutex);
+	job->task(job->context, index);
+	lockMutex(&pool->mutex);
+
+	if (++job->finished == job->count) {
+		broadcastCondition(&pool->workDone);
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI workerMain(LPVOID parameter) {
+#else
+static void *workerMain(void *parameter) {
+#endif
+	ThreadPool *pool = parameter;
+	lockMutex(&pool->mutex);
+	while (!pool->shutdown) {
+		PoolJob *job = findOpenJob(pool);
+		if (job == NULL) {
+			waitCondition(&pool->workReady, &pool->mutex);
+			continue;
+		}
+		workOnTask(pool, job);
+	}
+	unlockMutex(&pool->mutex);
+	return 0;
+}
+
+static int startThread(PoolThread *thread, ThreadPool *pool) {
+#ifdef _WIN32
+	*thread = CreateThread(NULL, 0, workerMain, pool, 0, NULL);
+	return *thread == NULL ? -1 : 0;
+#else
+	return pthread_create(thread, NULL, workerMain, pool) == 0 ? 0 : -1;
+#endif
+}
+
+static void joinThread(PoolThread thread) {
+#ifdef _WIN32
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+#else
+	pthread_join(thread, NULL);
+#endif
+}
+
+ThreadPool *createThreadPool(int threadCount) {
+	if (threadCount < 2) {
+		return NULL;
+	}
+	ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->threads = calloc((size_t)threadCount - 1, sizeof(PoolThread));
+	if (pool->threads == NULL) {
+		free(pool);
+		return NULL;
+	}
+	initMutex(&pool->mutex);
+	initCondition(&pool->workReady);
+	initCondition(&pool->workDone);
+
+	for (int i = 0; i < threadCount - 1; i++) {
+		if (startThread(&pool->threads[i], pool) != 0) {
+			break;
+		}
+		pool->threadCount++;
+	}
+	if (pool->threadCount == 0) {
+		destroyThreadPool(pool);
+		return NULL;
+	}
+	return pool;
+}
+
+void destroyThreadPool(ThreadPool *pool) {
+	if (pool == NULL) {
+		return;
+	}
+	lockMutex(&pool->mutex);
+	pool->shutdown = 1;
+	broadcastCondition(&pool->workReady);
+	unlockMutex(&pool->mutex);
+
+	for (int i = 0; i < pool->threadCount; i++) {
+		joinThread(pool->threads[i]);
+	}
+	destroyCondition(&pool->workDone);
+	destroyCondition(&pool->workReady);
+	destroyMutex(&pool->mutex);
+	free(pool->threads);
+	free(pool);
+}
+
+void runThreadPool(ThreadPool *pool, uint32_t count, ThreadPoolTask task, void *context) {
+	if (count == 0) {
+		return;
+	}
+	if (pool == NULL || count == 1) {
+		for (uint32_t i = 0; i < count; i++) {
+			task(context, i);
+		}
+		return;
+	}
+
+	PoolJob job;
+	job.task = task;
+	job.context = context;
+	job.count = count;
+	job.next = 0;
+	job.finished = 0;
+	lockMutex(&pool->mutex);
+	job.older = pool->jobs;
+	pool->jobs = &job;
+	broadcastCondition(&pool->workReady);
+
+	// This thread only works on its own job, so it's never stuck in someone else's task when its own finish
+	while (job.next < job.count) {
+		workOnTask(pool, &job);
+	}
+	while (job.finished < job.count) {
+		waitCondition(&pool->workDone, &pool->mutex);
+	}
+
+	// Jobs started after this one may have finished first, so it isn't always on top
+	PoolJob **link = &pool->jobs;
+	while (*link != &job) {
+		link = &(*link)->older;
+	}
+	*link = job.older;
+	unlockMutex(&pool->mutex);
+}
+
+int getProcessorCount(void) {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count < 1 ? 1 : (int)count;
+#endif
+}
+
+struct ThreadLock {
+	PoolMutex mutex;
+};
+
+ThreadLock *createThreadLock(void) {
+	ThreadLock *lock = malloc(sizeof(ThreadLock));
+	if (lock != NULL) {
+		initMutex(&lock->mutex);
+	}
+	return lock;
+}
+
+void destroyThreadLock(ThreadLock *lock) {
+	if (lock == NULL) {
+		return;
+	}
+	destroyMutex(&lock->mutex);
+	free(lock);
+}
+
+void acquireThreadLock(ThreadLock *lock) {
+	lockMutex(&lock->mutex);
+}
+
+void releaseThreadLock(ThreadLock *lock) {
+	unlockMutex(&lock->mutex);
+}
+
+struct ThreadCondition {
+	PoolCondition condition;
+};
+
+ThreadCondition *createThreadCondition(void) {
+	ThreadCondition *condition = malloc(sizeof(ThreadCondition));
+	if (condition != NULL) {
+		initCondition(&condition->condition);
+	}
+	return condition;
+}
+
+void destroyThreadCondition(ThreadCondition *condition) {
+	if (condition == NULL) {
+		return;
+	}
+	destroyCondition(&condition->condition);
+	free(condition);
+}
+
+void waitThreadCondition(ThreadCondition *condition, ThreadLock *lock) {
+	waitCondition(&condition->condition, &lock->mutex);
+}
+
+void wakeThreadCondition(ThreadCondition *condition) {
+	broadcastCondition(&condition->condition);
+}
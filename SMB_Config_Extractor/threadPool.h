@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+
+// A fixed set of worker threads that split up jobs of numbered tasks
+typedef struct ThreadPool ThreadPool;
+
+typedef void (*ThreadPoolTask)(void *context, uint32_t index);
+
+// Starts threadCount - 1 workers, the thread running a job works on it as well
+// Returns NULL if threadCount is below 2 or the threads couldn't be started
+ThreadPool *createThreadPool(int threadCount);
+void destroyThreadPool(ThreadPool *pool);
+// Runs task for every index below count and returns once they've all finished
+// Without a pool the tasks run in order on the calling thread
+// Tasks can run jobs of their own, idle workers take those on before anything older
+void runThreadPool(ThreadPool *pool, uint32_t count, ThreadPoolTask task, void *context);
+int getProcessorCount(void);
+
+// A plain lock for state that tasks share outside of the job itself
+typedef struct ThreadLock ThreadLock;
+
+ThreadLock *createThreadLock(void);
+void destroyThreadLock(ThreadLock *lock);
+void acquireThreadLock(ThreadLock *lock);
+void releaseThreadLock(ThreadLock *lock);
+
+// Lets a thread holding a lock sleep until another thread wakes it
+typedef struct ThreadCondition ThreadCondition;
+
+ThreadCondition *createThreadCondition(void);
+void destroyThreadCondition(ThreadCondition *condition);
+// The lock is released while waiting and held again when this returns, wakes can be spurious
+void waitThreadCondition(ThreadCondition *condition, ThreadLock *lock);
+// Wakes every waiting thread
+void wakeThreadCondition(ThreadCondition *condition);
@@ -1,14 +1,92 @@
 #include "xmlbuddy.h"
 
 #include <inttypes.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 
 static int printTagName(XMLBuddy *xmlBuddy, enum TAG_TYPE tagType);
 static int printAttrName(XMLBuddy *xmlBuddy, enum ATTRIBUTE_TYPE attrType);
 
+// Output goes to the file, or to the buffer if there isn't one
+static int reserveBuffer(XMLBuddy *xmlBuddy, size_t size) {
+	if (xmlBuddy->bufferFailed) {
+		return ERROR_BAD_STATE;
+	}
+	if (xmlBuddy->bufferCapacity - xmlBuddy->bufferSize >= size) {
+		return NO_ERROR;
+	}
+	size_t capacity = xmlBuddy->bufferCapacity == 0 ? 0x1000 : xmlBuddy->bufferCapacity;
+	while (capacity - xmlBuddy->bufferSize < size) {
+		capacity *= 2;
+	}
+	char *buffer = realloc(xmlBuddy->buffer, capacity);
+	if (buffer == NULL) {
+		// Later tags would change the state again, so the failure is kept apart from it
+		xmlBuddy->bufferFailed = 1;
+		return ERROR_BAD_STATE;
+	}
+	xmlBuddy->buffer = buffer;
+	xmlBuddy->bufferCapacity = capacity;
+	return NO_ERROR;
+}
+
+static void xmlWrite(XMLBuddy *xmlBuddy, const char *data, size_t size) {
+	if (xmlBuddy->output != NULL) {
+		fwrite(data, 1, size, xmlBuddy->output);
+	}
+	else if (reserveBuffer(xmlBuddy, size) == NO_ERROR) {
+		memcpy(xmlBuddy->buffer + xmlBuddy->bufferSize, data, size);
+		xmlBuddy->bufferSize += size;
+	}
+}
+
+static void xmlPutc(XMLBuddy *xmlBuddy, char c) {
+	if (xmlBuddy->output != NULL) {
+		putc(c, xmlBuddy->output);
+	}
+	else if (reserveBuffer(xmlBuddy, 1) == NO_ERROR) {
+		xmlBuddy->buffer[xmlBuddy->bufferSize++] = c;
+	}
+}
+
+static void xmlPuts(XMLBuddy *xmlBuddy, const char *string) {
+	if (xmlBuddy->output != NULL) {
+		fputs(string, xmlBuddy->output);
+	}
+	else {
+		xmlWrite(xmlBuddy, string, strlen(string));
+	}
+}
+
+static void xmlPrintf(XMLBuddy *xmlBuddy, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	if (xmlBuddy->output != NULL) {
+		vfprintf(xmlBuddy->output, format, args);
+	}
+	else {
+		char text[64];
+		va_list retry;
+		va_copy(retry, args);
+		int length = vsnprintf(text, sizeof(text), format, args);
+		if (length >= 0 && (size_t)length < sizeof(text)) {
+			xmlWrite(xmlBuddy, text, (size_t)length);
+		}
+		// Big doubles print a lot of digits
+		else if (length >= 0 && reserveBuffer(xmlBuddy, (size_t)length + 1) == NO_ERROR) {
+			vsnprintf(xmlBuddy->buffer + xmlBuddy->bufferSize, (size_t)length + 1, format, retry);
+			xmlBuddy->bufferSize += (size_t)length;
+		}
+		va_end(retry);
+	}
+	va_end(args);
+}
+
 static int handleIndentation(XMLBuddy *xmlBuddy) {
-	fputc('\n', xmlBuddy->output);
+	xmlPutc(xmlBuddy, '\n');
 	for (int i = 0; i < xmlBuddy->indentation; i++) {
-		fputs("    ", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "    ");
 	}
 	return NO_ERROR;
 }
@@ -16,6 +94,10 @@ static int handleIndentation(XMLBuddy *xmlBuddy) {
 
 XMLBuddy *initXMLBuddy(char *filename, XMLBuddy *xmlBuddy, int prettyPrint) {
 	xmlBuddy->output = NULL;
+	xmlBuddy->buffer = NULL;
+	xmlBuddy->bufferSize = 0;
+	xmlBuddy->bufferCapacity = 0;
+	xmlBuddy->bufferFailed = 0;
 	xmlBuddy->state = STATE_NEW;
 	FILE *output = fopen(filename, "w");
 	if (output == NULL) {
@@ -36,6 +118,10 @@ XMLBuddy *initXMLBuddy(char *filename, XMLBuddy *xmlBuddy, int prettyPrint) {
 
 XMLBuddy *initXMLBuddyFile(FILE *file, XMLBuddy *xmlBuddy, int prettyPrint) {
 	xmlBuddy->output = NULL;
+	xmlBuddy->buffer = NULL;
+	xmlBuddy->bufferSize = 0;
+	xmlBuddy->bufferCapacity = 0;
+	xmlBuddy->bufferFailed = 0;
 	xmlBuddy->state = STATE_NEW;
 	if (file == NULL) {
 		xmlBuddy->state = STATE_ERROR;
@@ -52,20 +138,58 @@ XMLBuddy *initXMLBuddyFile(FILE *file, XMLBuddy *xmlBuddy, int prettyPrint) {
 	return xmlBuddy;
 }
 
+XMLBuddy *initXMLBuddyBuffer(XMLBuddy *xmlBuddy, XMLBuddy *parent) {
+	// Anything written to the buffer goes inside whatever tag the parent is in
+	if (parent->state == STATE_OPENING_TAG) {
+		xmlPutc(parent, '>');
+		parent->state = STATE_GENERAL;
+		parent->indentation++;
+	}
+	*xmlBuddy = *parent;
+	xmlBuddy->output = NULL;
+	xmlBuddy->buffer = NULL;
+	xmlBuddy->bufferSize = 0;
+	xmlBuddy->bufferCapacity = 0;
+	xmlBuddy->bufferFailed = 0;
+	if (parent->state != STATE_GENERAL) {
+		xmlBuddy->state = STATE_ERROR;
+		return NULL;
+	}
+	return xmlBuddy;
+}
+
+int appendXMLBuddy(XMLBuddy *xmlBuddy, XMLBuddy *buffer) {
+	if (xmlBuddy->state != STATE_GENERAL || buffer->state != STATE_GENERAL || buffer->bufferFailed) {
+		return ERROR_BAD_STATE;
+	}
+	xmlWrite(xmlBuddy, buffer->buffer, buffer->bufferSize);
+	xmlBuddy->indentation = buffer->indentation;
+	xmlBuddy->endTagOnNewLine = buffer->endTagOnNewLine;
+	return NO_ERROR;
+}
+
 void closeXMlBuddy(XMLBuddy *xmlBuddy) {
-	fclose(xmlBuddy->output);
+	if (xmlBuddy->output != NULL) {
+		fclose(xmlBuddy->output);
+	}
+	free(xmlBuddy->buffer);
+	xmlBuddy->buffer = NULL;
+	xmlBuddy->bufferSize = 0;
+	xmlBuddy->bufferCapacity = 0;
 	xmlBuddy->output = NULL;
 	xmlBuddy->state = STATE_CLOSED;
 	return;
 }
 
 void flushXMLBuddy(XMLBuddy *xmlBuddy) {
-	fflush(xmlBuddy->output);
+	if (xmlBuddy->output != NULL) {
+		fflush(xmlBuddy->output);
+	}
 }
 
 int startTagType(XMLBuddy *xmlBuddy, enum TAG_TYPE tagType) {
 	if (xmlBuddy->state == STATE_OPENING_TAG) {
-		putc('>', xmlBuddy->output);
+		xmlPutc(xmlBuddy, '>');
 		xmlBuddy->state = STATE_GENERAL;
 		xmlBuddy->indentation++;
 	}
@@ -74,9 +198,9 @@ int startTagType(XMLBuddy *xmlBuddy, enum TAG_TYPE tagType) {
 	}
 	handleIndentation(xmlBuddy);
 
-	putc('<', xmlBuddy->output);
+	xmlPutc(xmlBuddy, '<');
 	printTagName(xmlBuddy, tagType);
-	putc(' ', xmlBuddy->output);
+	xmlPutc(xmlBuddy, ' ');
 
 	xmlBuddy->state = STATE_OPENING_TAG;
 	xmlBuddy->tagStack[xmlBuddy->indentation] = tagType;
@@ -85,7 +209,7 @@ int startTagType(XMLBuddy *xmlBuddy, enum TAG_TYPE tagType) {
 
 int endTag(XMLBuddy *xmlBuddy) {
 	if (xmlBuddy->state == STATE_OPENING_TAG) {
-		fputs(" />", xmlBuddy->output);
+		xmlPuts(xmlBuddy, " />");
 		xmlBuddy->state = STATE_GENERAL;
 		xmlBuddy->endTagOnNewLine = 1;
 		return NO_ERROR;
@@ -105,9 +229,9 @@ int endTag(XMLBuddy *xmlBuddy) {
 		xmlBuddy->endTagOnNewLine = 1;
 	}
 
-	fputs("</", xmlBuddy->output);
+	xmlPuts(xmlBuddy, "</");
 	printTagName(xmlBuddy, xmlBuddy->tagStack[xmlBuddy->indentation]);
-	fputc('>', xmlBuddy->output);
+	xmlPutc(xmlBuddy, '>');
 
 	return NO_ERROR;
 }
@@ -118,9 +242,9 @@ int addAttrTypeStr(XMLBuddy *xmlBuddy, enum ATTRIBUTE_TYPE attr, char *attrValue
 	}
 	
 	printAttrName(xmlBuddy, attr);
-	fputc('"', xmlBuddy->output);
-	fputs(attrValue, xmlBuddy->output);
-	fputs("\" ", xmlBuddy->output);
+	xmlPutc(xmlBuddy, '"');
+	xmlPuts(xmlBuddy, attrValue);
+	xmlPuts(xmlBuddy, "\" ");
 
 	xmlBuddy->endTagOnNewLine = 0;
 	return NO_ERROR;
@@ -132,9 +256,9 @@ int addAttrTypeInt(XMLBuddy *xmlBuddy, enum ATTRIBUTE_TYPE attr, int attrValue)
 	}
 
 	printAttrName(xmlBuddy, attr);
-	fputc('"', xmlBuddy->output);
-	fprintf(xmlBuddy->output, "%d", attrValue);
-	fputs("\" ", xmlBuddy->output);
+	xmlPutc(xmlBuddy, '"');
+	xmlPrintf(xmlBuddy, "%d", attrValue);
+	xmlPuts(xmlBuddy, "\" ");
 
 	xmlBuddy->endTagOnNewLine = 0;
 	return NO_ERROR;
@@ -146,9 +270,9 @@ int addAttrTypeDouble(XMLBuddy *xmlBuddy, enum ATTRIBUTE_TYPE attr, double attrV
 	}
 
 	printAttrName(xmlBuddy, attr);
-	fputc('"', xmlBuddy->output);
-	fprintf(xmlBuddy->output, "%f", attrValue);
-	fputs("\" ", xmlBuddy->output);
+	xmlPutc(xmlBuddy, '"');
+	xmlPrintf(xmlBuddy, "%f", attrValue);
+	xmlPuts(xmlBuddy, "\" ");
 
 	xmlBuddy->endTagOnNewLine = 0;
 	return NO_ERROR;
@@ -156,7 +280,7 @@ int addAttrTypeDouble(XMLBuddy *xmlBuddy, enum ATTRIBUTE_TYPE attr, double attrV
 
 int addValStr(XMLBuddy *xmlBuddy, char *value) {
 	if (xmlBuddy->state == STATE_OPENING_TAG) {
-		putc('>', xmlBuddy->output);
+		xmlPutc(xmlBuddy, '>');
 		xmlBuddy->state = STATE_GENERAL;
 		xmlBuddy->indentation++;
 	}
@@ -164,7 +288,7 @@ int addValStr(XMLBuddy *xmlBuddy, char *value) {
 		return ERROR_BAD_STATE;
 	}
 
-	fputs(value, xmlBuddy->output);
+	xmlPuts(xmlBuddy, value);
 
 	xmlBuddy->endTagOnNewLine = 0;
 	return NO_ERROR;
@@ -172,7 +296,7 @@ int addValStr(XMLBuddy *xmlBuddy, char *value) {
 
 int addValInt(XMLBuddy *xmlBuddy, int value) {
 	if (xmlBuddy->state == STATE_OPENING_TAG) {
-		putc('>', xmlBuddy->output);
+		xmlPutc(xmlBuddy, '>');
 		xmlBuddy->state = STATE_GENERAL;
 		xmlBuddy->indentation++;
 	}
@@ -180,7 +304,7 @@ int addValInt(XMLBuddy *xmlBuddy, int value) {
 		return ERROR_BAD_STATE;
 	}
 
-	fprintf(xmlBuddy->output, "%d", value);
+	xmlPrintf(xmlBuddy, "%d", value);
 
 	xmlBuddy->endTagOnNewLine = 0;
 	return NO_ERROR;
@@ -188,7 +312,7 @@ int addValInt(XMLBuddy *xmlBuddy, int value) {
 
 int addValUInt32(XMLBuddy *xmlBuddy, uint32_t value) {
 	if (xmlBuddy->state == STATE_OPENING_TAG) {
-		putc('>', xmlBuddy->output);
+		xmlPutc(xmlBuddy, '>');
 		xmlBuddy->state = STATE_GENERAL;
 		xmlBuddy->indentation++;
 	}
@@ -196,7 +320,7 @@ int addValUInt32(XMLBuddy *xmlBuddy, uint32_t value) {
 		return ERROR_BAD_STATE;
 	}
 
-	fprintf(xmlBuddy->output, "%" PRIu32, value);
+	xmlPrintf(xmlBuddy, "%" PRIu32, value);
 	
 	xmlBuddy->endTagOnNewLine = 0;
 	return NO_ERROR;
@@ -204,7 +328,7 @@ int addValUInt32(XMLBuddy *xmlBuddy, uint32_t value) {
 
 int addValDouble(XMLBuddy *xmlBuddy, double value) {
 	if (xmlBuddy->state == STATE_OPENING_TAG) {
-		putc('>', xmlBuddy->output);
+		xmlPutc(xmlBuddy, '>');
 		xmlBuddy->state = STATE_GENERAL;
 		xmlBuddy->indentation++;
 	}
@@ -212,7 +336,7 @@ int addValDouble(XMLBuddy *xmlBuddy, double value) {
 		return ERROR_BAD_STATE;
 	}
 
-	fprintf(xmlBuddy->output, "%f", value);
+	xmlPrintf(xmlBuddy, "%f", value);
 
 	xmlBuddy->endTagOnNewLine = 0;
 	return NO_ERROR;
@@ -359,162 +483,163 @@ void writeFogType(XMLBuddy *xmlBuddy, uint8_t fogType) {
 static int printTagName(XMLBuddy *xmlBuddy, enum TAG_TYPE tagType) {
 	switch (tagType) {
 	case TAG_TITLE:
-		fputs("superMonkeyBallStage", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "superMonkeyBallStage");
 		break;
 	case TAG_MODEL_IMPORT:
-		fputs("modelImport", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "modelImport");
 		break;
 	case TAG_START:
-		fputs("start", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "start");
 		break;
 	case TAG_END:
-		fputs("end", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "end");
 		break;
 	case TAG_NAME:
-		fputs("name", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "name");
 		break;
 	case TAG_POSITION:
-		fputs("position", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "position");
 		break;
 	case TAG_ROTATION:
-		fputs("rotation", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "rotation");
 		break;
 	case TAG_SCALE:
-		fputs("scale", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "scale");
 		break;
 	case TAG_BACKGROUND_MODEL:
-		fputs("backgroundModel", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "backgroundModel");
 		break;
 	case TAG_FOG:
-		fputs("fog", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "fog");
 		break;
 	case TAG_RED:
-		fputs("red", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "red");
 		break;
 	case TAG_GREEN:
-		fputs("green", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "green");
 		break;
 	case TAG_BLUE:
-		fputs("blue", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "blue");
 		break;
 	case TAG_FALLOUT_PLANE:
-		fputs("falloutPlane", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "falloutPlane");
 		break;
 	case TAG_ITEM_GROUP:
-		fputs("itemGroup", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "itemGroup");
 		break;
 	case TAG_ROTATION_CENTER:
-		fputs("rotationCenter", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "rotationCenter");
 		break;
 	case TAG_INITIAL_ROTATION:
-		fputs("initialRotation", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "initialRotation");
 		break;
 	case TAG_ANIM_SEESAW_TYPE:
-		fputs("animSeesawType", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "animSeesawType");
 		break;
 	case TAG_SEESAW_SENSITIVITY:
-		fputs("seesawSensitivity", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "seesawSensitivity");
 		break;
 	case TAG_SEESAW_STIFFNESS:
-		fputs("seesawResetStiffness", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "seesawResetStiffness");
 		break;
 	case TAG_SEESAW_BOUNDS:
-		fputs("seesawRotationBoundss", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "seesawRotationBoundss");
 		break;
 	case TAG_CONVEYOR_SPEED:
-		fputs("conveyorSpeed", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "conveyorSpeed");
 		break;
 	case TAG_COLLISION_GRID:
-		fputs("collisionGrid", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "collisionGrid");
 		break;
 	case TAG_STEP:
-		fputs("step", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "step");
 		break;
 	case TAG_COUNT:
-		fputs("count", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "count");
 		break;
 	case TAG_COLLISION:
-		fputs("collision", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "collision");
 		break;
 	case TAG_OBJECT:
-		fputs("object", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "object");
 		break;
 	case TAG_GOAL:
-		fputs("goal", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "goal");
 		break;
 	case TAG_TYPE:
-		fputs("type", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "type");
 		break;
 	case TAG_BUMPER:
-		fputs("bumper", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "bumper");
 		break;
 	case TAG_JAMABAR:
-		fputs("jamabar", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "jamabar");
 		break;
 	case TAG_BANANA:
-		fputs("banana", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "banana");
 		break;
 	case TAG_CONE:
-		fputs("cone", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "cone");
 		break;
 	case TAG_SPHERE:
-		fputs("sphere", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "sphere");
 		break;
 	case TAG_CYLINDER:
-		fputs("cylinder", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "cylinder");
 		break;
 	case TAG_FALLOUT_VOLUME:
-		fputs("falloutVolume", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "falloutVolume");
+		break;
 	case TAG_LEVEL_MODEL:
-		fputs("levelModel", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "levelModel");
 		break;
 	case TAG_REFLECTIVE_MODEL:
-		fputs("reflectiveModel", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "reflectiveModel");
 		break;
 	case TAG_WORMHOLE:
-		fputs("wormhole", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "wormhole");
 		break;
 	case TAG_SWITCH:
-		fputs("switch", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "switch");
 		break;
 	case TAG_DESTINATION_NAME:
-		fputs("destinationName", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "destinationName");
 		break;
 	case TAG_ANIM_LOOP_TIME:
-		fputs("animLoopTime", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "animLoopTime");
 		break;
 	case TAG_ANIM_KEYFRAMES:
-		fputs("animKeyframes", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "animKeyframes");
 		break;
 	case TAG_POS_X:
-		fputs("posX", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "posX");
 		break;
 	case TAG_POS_Y:
-		fputs("posY", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "posY");
 		break;
 	case TAG_POS_Z:
-		fputs("posZ", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "posZ");
 		break;
 	case TAG_ROT_X:
-		fputs("rotX", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "rotX");
 		break;
 	case TAG_ROT_Y:
-		fputs("rotY", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "rotY");
 		break;
 	case TAG_ROT_Z:
-		fputs("rotZ", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "rotZ");
 		break;
 	case TAG_KEYFRAME:
-		fputs("keyframe", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "keyframe");
 		break;
 	case TAG_ANIM_GROUP_ID:
-		fputs("animGroupId", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "animGroupId");
 		break;
 	case TAG_ANIM_INITIAL_STATE:
-		fputs("animInitialState", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "animInitialState");
 		break;
 	default:
-		fputs("Invalid", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "Invalid");
 	}
 	return NO_ERROR;
 }
@@ -522,31 +647,31 @@ static int printTagName(XMLBuddy *xmlBuddy, enum TAG_TYPE tagType) {
 static int printAttrName(XMLBuddy *xmlBuddy, enum ATTRIBUTE_TYPE attrType) {
 	switch (attrType) {
 	case ATTR_VERSION:
-		fputs("version=", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "version=");
 		break;
 	case ATTR_TYPE:
-		fputs("type=", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "type=");
 		break;
 	case ATTR_X:
-		fputs("x=", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "x=");
 		break;
 	case ATTR_Y:
-		fputs("y=", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "y=");
 		break;
 	case ATTR_Z:
-		fputs("z=", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "z=");
 		break;
 	case ATTR_TIME:
-		fputs("time=", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "time=");
 		break;
 	case ATTR_VALUE:
-		fputs("value=", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "value=");
 		break;
 	case ATTR_EASING:
-		fputs("easing=", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "easing=");
 		break;
 	default:
-		fputs("Invalid=", xmlBuddy->output);
+		xmlPuts(xmlBuddy, "Invalid=");
 	}
 	return NO_ERROR;
 }
\ No newline at end of file
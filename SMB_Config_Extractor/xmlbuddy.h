@@ -127,7 +127,11 @@ enum STATE {
 
 
 typedef struct XMLBuddy {
-	FILE *output;
+	FILE *output;          // NULL when writing to buffer
+	char *buffer;
+	size_t bufferSize;
+	size_t bufferCapacity;
+	int bufferFailed;      // Set once the buffer ran out of memory, what's in it is incomplete
 	enum STATE state;
 	int prettyPrint;
 	int indentation;
@@ -149,6 +153,10 @@ typedef struct {
 
 XMLBuddy *initXMLBuddy(char *filename, XMLBuddy *xmlBuddy, int prettyPrint);
 XMLBuddy *initXMLBuddyFile(FILE *file, XMLBuddy *xmlBuddy, int prettyPrint);
+// Starts a buddy that writes to memory at the parent's current position, to be appended to it later
+XMLBuddy *initXMLBuddyBuffer(XMLBuddy *xmlBuddy, XMLBuddy *parent);
+// Writes out everything buffered in buffer, which has to have been started from xmlBuddy's position
+int appendXMLBuddy(XMLBuddy *xmlBuddy, XMLBuddy *buffer);
 void closeXMlBuddy(XMLBuddy *xmlBuddy);
 void flushXMLBuddy(XMLBuddy *xmlBuddy);
 //int startTag(XMLBuddy *xmlBuddy, char *tagName);
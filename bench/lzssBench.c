@@ -0,0 +1,122 @@
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+// Times lzssDecode on SMB lz files, usually real stage archives (STAGE001.lz and so on)
+// Built twice, lzssBenchByteCopy decodes with LZSS_BYTE_COPY to show what the wide reference copy gains
+//     Usage: lzssBench FILE... [-n ITERATIONS]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../SMB_Config_Extractor/lzss.h"
+
+#define DEFAULT_ITERATIONS 50
+
+static double now(void) {
+	struct timespec time;
+	timespec_get(&time, TIME_UTC);
+	return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+static uint8_t *readWholeFile(const char *filename, uint32_t *size) {
+	FILE *file = fopen(filename, "rb");
+	if (file == NULL) {
+		return NULL;
+	}
+	uint8_t *data = NULL;
+	long fileSize = -1;
+	if (fseek(file, 0, SEEK_END) == 0) {
+		fileSize = ftell(file);
+	}
+	if (fileSize > 0 && (unsigned long)fileSize <= UINT32_MAX && fseek(file, 0, SEEK_SET) == 0) {
+		data = malloc((size_t)fileSize);
+		if (data != NULL && fread(data, 1, (size_t)fileSize, file) != (size_t)fileSize) {
+			free(data);
+			data = NULL;
+		}
+	}
+	fclose(file);
+	*size = (uint32_t)fileSize;
+	return data;
+}
+
+// Returns 0 if the file decoded on every run, -1 otherwise
+static int benchFile(const char *filename, int iterations) {
+	uint32_t lzSize;
+	uint8_t *lz = readWholeFile(filename, &lzSize);
+	SMBLZHeader header;
+	if (lz == NULL || readSMBLZHeader(lz, lzSize, &header) != 0) {
+		printf("%s: Not a readable SMB lz file\n", filename);
+		free(lz);
+		return -1;
+	}
+	uint32_t dataSize = header.compressedSize - SMB_LZ_HEADER_SIZE;
+	uint8_t *output = malloc(header.decompressedSize > 0 ? header.decompressedSize : 1);
+	if (output == NULL) {
+		free(lz);
+		return -1;
+	}
+
+	// The first run warms the caches and checks the stream before it is timed
+	int result = lzssDecode(lz + SMB_LZ_HEADER_SIZE, dataSize, output, header.decompressedSize);
+	double best = 0.0;
+	double total = 0.0;
+	for (int i = 0; i < iterations && result == 0; i++) {
+		double start = now();
+		result = lzssDecode(lz + SMB_LZ_HEADER_SIZE, dataSize, output, header.decompressedSize);
+		double elapsed = now() - start;
+		total += elapsed;
+		if (i == 0 || elapsed < best) {
+			best = elapsed;
+		}
+	}
+
+	if (result != 0) {
+		printf("%s: Failed to decode\n", filename);
+	}
+	else {
+		double megabytes = header.decompressedSize / (1024.0 * 1024.0);
+		printf("%s: %u -> %u bytes, %d runs, best %.1f MB/s, average %.1f MB/s\n", filename, header.compressedSize, header.decompressedSize,
+			iterations, best > 0.0 ? megabytes / best : 0.0, total > 0.0 ? megabytes * iterations / total : 0.0);
+	}
+	free(output);
+	free(lz);
+	return result;
+}
+
+int main(int argc, char *argv[]) {
+	int iterations = DEFAULT_ITERATIONS;
+	int files = 0;
+	int result = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			iterations = atoi(argv[++i]);
+			if (iterations < 1) {
+				iterations = 1;
+			}
+		}
+	}
+#ifdef LZSS_BYTE_COPY
+	printf("Copying references a byte at a time\n");
+#else
+	printf("Copying references with the wide kernel\n");
+#endif
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			i++;
+			continue;
+		}
+		files++;
+		if (benchFile(argv[i], iterations) != 0) {
+			result = 1;
+		}
+	}
+	if (files == 0) {
+		printf("Usage: %s FILE... [-n ITERATIONS]\n", argv[0]);
+		return 1;
+	}
+	return result;
+}
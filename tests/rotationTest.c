@@ -0,0 +1,95 @@
+// Converts every rotation a stage can hold with convertItemRotations and checks the floats bit for bit
+// against the formulas it replaced, built once per path (scalar, SSE2, AVX2)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../SMB_Config_Extractor/itemArray.h"
+
+// Not a multiple of 8, so every column ends in the scalar tail and the next one starts unaligned
+#define ROTATION_COUNT (65536 + 5)
+#define FIELD_COUNT 4
+// Exit code ctest reports as skipped
+#define SKIP_TEST 77
+
+static uint32_t floatBits(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+// What the XML extractor used to do
+static float oldDoubleRotation(uint16_t rotation) {
+	const double conversionFactor = 360.0 / 65536.0;
+	return (float)(conversionFactor * rotation);
+}
+
+// What the legacy extractor used to do
+static float oldFloatRotation(uint16_t rotation) {
+	float angle = (float)rotation;
+	angle = angle * 360.0f / 65536.0f;
+	return angle;
+}
+
+int main(void) {
+#if defined(__AVX2__) && defined(__GNUC__)
+	if (!__builtin_cpu_supports("avx2")) {
+		printf("AVX2 isn't supported on this processor\n");
+		return SKIP_TEST;
+	}
+#endif
+	ItemArray array;
+	array.count = ROTATION_COUNT;
+	array.fieldCount = FIELD_COUNT;
+	array.columns = malloc((size_t)ROTATION_COUNT * FIELD_COUNT * sizeof(uint32_t));
+	if (array.columns == NULL) {
+		return 1;
+	}
+	for (uint32_t i = 0; i < ROTATION_COUNT * FIELD_COUNT; i++) {
+		array.columns[i] = i & 0xFFFF;
+	}
+
+	// Field 0 is left alone, the other three are converted as one run like a rotation triple
+	convertItemRotations(&array, 1, FIELD_COUNT - 1);
+
+	uint32_t failures = 0;
+	for (uint32_t field = 0; field < FIELD_COUNT; field++) {
+		for (uint32_t index = 0; index < ROTATION_COUNT; index++) {
+			uint32_t i = field * ROTATION_COUNT + index;
+			uint16_t rotation = (uint16_t)i;
+			uint32_t actual = itemU32(&array, field, index);
+			int matches;
+			if (field == 0) {
+				matches = actual == rotation;
+			}
+			else {
+				matches = actual == floatBits(oldDoubleRotation(rotation)) && actual == floatBits(oldFloatRotation(rotation))
+					&& actual == floatBits(convertRotation(rotation));
+			}
+			if (!matches) {
+				if (failures < 10) {
+					printf("Field %u item %u: rotation 0x%04X converted to 0x%08X, expected %.9g\n", field, index, rotation, actual,
+						field == 0 ? (double)rotation : (double)oldDoubleRotation(rotation));
+				}
+				failures++;
+			}
+		}
+	}
+
+	// Fields past the end of the array are refused without touching anything
+	uint32_t before = itemU32(&array, 0, 1);
+	convertItemRotations(&array, 0, FIELD_COUNT + 1);
+	if (itemU32(&array, 0, 1) != before) {
+		printf("Converted fields past the end of the array\n");
+		failures++;
+	}
+
+	freeItemArray(&array);
+	if (failures > 0) {
+		printf("%u mismatches\n", failures);
+		return 1;
+	}
+	printf("All %u rotations match\n", ROTATION_COUNT * (FIELD_COUNT - 1));
+	return 0;
+}